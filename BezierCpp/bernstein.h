@@ -0,0 +1,589 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BERNSTEIN_H
+#define BERNSTEIN_H
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <sys/types.h>
+#include <vector>
+
+/*!
+ * \brief Highest curve order for which binomials and coefficient matrices are precomputed
+ *
+ * Binomials are tabulated at compile time, coefficient matrices during static initialization.
+ * Higher orders are computed on first use.
+ */
+#ifndef BEZIER_PRECOMPUTED_ORDER
+#define BEZIER_PRECOMPUTED_ORDER 32
+#endif
+
+namespace Bezier
+{
+/*!
+ * \brief Low-level kernels operating directly on Bernstein coefficients
+ *
+ * Each function works on a single coordinate of a curve: a contiguous array of
+ * n coefficients (e.g. one column of the control point matrix) describing a
+ * polynomial of degree n - 1, where n = 0 describes zero polynomial.
+ * Apart from roots(), which keeps its subdivision stack on heap, none of them allocates memory.
+ */
+namespace Bernstein
+{
+/*!
+ * \brief Number of coefficients for which callers can keep scratch space on stack
+ */
+const uint max_stack_coeffs = 64;
+
+/*!
+ * \brief Number of parameters evaluated together by batch kernels
+ */
+const uint batch_size = 256;
+
+/*!
+ * \brief Compute binomial coefficient at compile time
+ * \param n Number of elements
+ * \param k Number of chosen elements
+ * \return Binomial coefficient (n choose k)
+ *
+ * Exact for all n up to 54; C(55, 26) is the first value where an intermediate product
+ * isn't representable in double and gets rounded
+ */
+constexpr double binomialRecursive(uint n, uint k)
+{
+  return k > n ? 0 : k == 0 ? 1 : binomialRecursive(n, k - 1) * (n - k + 1) / k;
+}
+
+/// Compile-time sequence of indices
+template <std::size_t... I> struct IndexSequence
+{
+  typedef IndexSequence type;
+};
+
+/// Concatenation of two index sequences, second one shifted by length of the first
+template <typename S1, typename S2> struct ConcatIndices;
+template <std::size_t... I1, std::size_t... I2>
+struct ConcatIndices<IndexSequence<I1...>, IndexSequence<I2...>> : IndexSequence<I1..., (sizeof...(I1) + I2)...>
+{
+};
+
+/// Index sequence 0 ... N - 1, generated with logarithmic template recursion depth
+template <std::size_t N>
+struct MakeIndexSequence
+    : ConcatIndices<typename MakeIndexSequence<N / 2>::type, typename MakeIndexSequence<N - N / 2>::type>
+{
+};
+template <> struct MakeIndexSequence<0> : IndexSequence<>
+{
+};
+template <> struct MakeIndexSequence<1> : IndexSequence<0>
+{
+};
+
+/// Compile-time table of binomial coefficients, entry n * (order + 1) + k holds (n choose k)
+template <typename Indices> struct BinomialTable;
+template <std::size_t... I> struct BinomialTable<IndexSequence<I...>>
+{
+  static constexpr uint size = BEZIER_PRECOMPUTED_ORDER + 1;
+  static constexpr double values[sizeof...(I)] = {binomialRecursive(I / size, I % size)...};
+};
+template <std::size_t... I> constexpr double BinomialTable<IndexSequence<I...>>::values[sizeof...(I)];
+
+/*!
+ * \brief Get binomial coefficient
+ * \param n Number of elements
+ * \param k Number of chosen elements
+ * \return Binomial coefficient (n choose k)
+ *
+ * Read from compile-time table for n up to BEZIER_PRECOMPUTED_ORDER
+ */
+inline double binomial(uint n, uint k)
+{
+  typedef BinomialTable<MakeIndexSequence<(BEZIER_PRECOMPUTED_ORDER + 1) * (BEZIER_PRECOMPUTED_ORDER + 1)>::type> Table;
+  if (n < Table::size)
+    return k > n ? 0 : Table::values[n * Table::size + k];
+  return binomialRecursive(n, k);
+}
+
+/*!
+ * \brief Evaluate the polynomial with de Casteljau algorithm
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param t Curve parameter
+ * \param scratch Working memory for at least n values
+ * \return Value of polynomial for a given t
+ *
+ * Numerically most stable evaluation, with O(n^2) complexity
+ */
+inline double deCasteljau(const double* coeffs, uint n, double t, double* scratch)
+{
+  if (n == 0)
+    return 0;
+
+  std::copy(coeffs, coeffs + n, scratch);
+  for (uint k = n - 1; k > 0; k--)
+    for (uint i = 0; i < k; i++)
+      scratch[i] = (1 - t) * scratch[i] + t * scratch[i + 1];
+  return scratch[0];
+}
+
+/*!
+ * \brief Evaluate the polynomial with Horner scheme adapted for Bernstein basis
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param t Curve parameter
+ * \return Value of polynomial for a given t
+ *
+ * Binomial coefficients and powers of t are accumulated on the fly, giving O(n) complexity
+ */
+inline double horner(const double* coeffs, uint n, double t)
+{
+  if (n == 0)
+    return 0;
+  if (n == 1)
+    return coeffs[0];
+
+  const uint degree = n - 1;
+  double u = 1 - t;
+  double binomial_coeff = 1;
+  double t_power = 1;
+  double result = coeffs[0] * u;
+  for (uint k = 1; k < degree; k++)
+  {
+    t_power *= t;
+    binomial_coeff = binomial_coeff * (degree - k + 1) / k;
+    result = (result + t_power * binomial_coeff * coeffs[k]) * u;
+  }
+  return result + t_power * t * coeffs[degree];
+}
+
+/*!
+ * \brief Split the polynomial into two parts with de Casteljau algorithm
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param z Parameter t at which to split
+ * \param left Array receiving n coefficients of part t = [0, z], may be the same as coeffs
+ * \param right Array receiving n coefficients of part t = [z, 1], may be the same as coeffs
+ *
+ * Both parts are collected from a single de Casteljau triangle, with O(n^2) complexity
+ */
+inline void split(const double* coeffs, uint n, double z, double* left, double* right)
+{
+  if (right != coeffs)
+    std::copy(coeffs, coeffs + n, right);
+  // first value of each level belongs to left part, last one stays in place as right part
+  for (uint k = 0; k < n; k++)
+  {
+    left[k] = right[0];
+    for (uint i = 0; i < n - 1 - k; i++)
+      right[i] = (1 - z) * right[i] + z * right[i + 1];
+  }
+}
+
+/*!
+ * \brief Get the part of polynomial between two parameters
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param t0 Parameter where the part starts
+ * \param t1 Parameter where the part ends (part is reversed if t1 < t0)
+ * \param result Array receiving n coefficients of part t = [t0, t1], may be the same as coeffs
+ * \param scratch Working memory for at least n values
+ *
+ * Computed with two de Casteljau splits, where the first split is done at whichever end
+ * makes the reparametrization of the second one better conditioned
+ */
+inline void interval(const double* coeffs, uint n, double t0, double t1, double* result, double* scratch)
+{
+  if (t1 < t0)
+  {
+    interval(coeffs, n, t1, t0, result, scratch);
+    std::reverse(result, result + n);
+  }
+  else if (std::fabs(t1) >= std::fabs(1 - t0))
+  {
+    // [0, t1], then its part [t0 / t1, 1]
+    split(coeffs, n, t1, result, scratch);
+    split(result, n, t0 / t1, scratch, result);
+  }
+  else
+  {
+    // [t0, 1], then its part [0, (t1 - t0) / (1 - t0)]
+    split(coeffs, n, t0, scratch, result);
+    split(result, n, (t1 - t0) / (1 - t0), result, scratch);
+  }
+}
+
+/*!
+ * \brief Find the parameter range where polynomial can lie within given bounds
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param lower Lower bound of polynomial values
+ * \param upper Upper bound of polynomial values
+ * \param t_min Receives the lowest parameter where polynomial can lie within bounds
+ * \param t_max Receives the highest parameter where polynomial can lie within bounds
+ * \return False if polynomial surely lies outside of bounds for all t in [0, 1]
+ *
+ * Graph of polynomial lies in the convex hull of points (k / (n - 1), coeffs[k]), so the
+ * range is found by intersecting every segment between those points with the bounds.
+ * Used for Bezier clipping, with O(n^2) complexity.
+ */
+inline bool clip(const double* coeffs, uint n, double lower, double upper, double& t_min, double& t_max)
+{
+  t_min = 1;
+  t_max = 0;
+  auto include = [&](double t)
+  {
+    t_min = std::min(t_min, t);
+    t_max = std::max(t_max, t);
+  };
+
+  const double step = n > 1 ? 1. / (n - 1) : 0;
+  for (uint i = 0; i < n; i++)
+  {
+    if (coeffs[i] >= lower && coeffs[i] <= upper)
+      include(i * step);
+    for (uint j = i + 1; j < n; j++)
+      for (double bound : {lower, upper})
+        if ((coeffs[i] - bound) * (coeffs[j] - bound) < 0)
+          include((i + (j - i) * (bound - coeffs[i]) / (coeffs[j] - coeffs[i])) * step);
+  }
+  return t_min <= t_max;
+}
+
+/*!
+ * \brief Find roots of the polynomial up to cubic in closed form
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients, at most 4
+ * \param roots Array receiving at most n - 1 roots, in ascending order
+ * \return Number of roots in [0, 1]
+ *
+ * Polynomial is converted to power basis and solved with quadratic formula or
+ * Cardano's method, after which each root is polished with Newton iterations.
+ * Multiple roots are reported once, as with roots. Identically zero polynomial
+ * has no isolated roots, so none are returned.
+ */
+inline uint rootsClosedForm(const double* coeffs, uint n, double* roots)
+{
+  // power basis coefficients: a[0] + a[1] t + a[2] t^2 + a[3] t^3
+  double a[4] = {0, 0, 0, 0};
+  switch (n)
+  {
+  case 2:
+    a[0] = coeffs[0];
+    a[1] = coeffs[1] - coeffs[0];
+    break;
+  case 3:
+    a[0] = coeffs[0];
+    a[1] = 2 * (coeffs[1] - coeffs[0]);
+    a[2] = coeffs[0] - 2 * coeffs[1] + coeffs[2];
+    break;
+  case 4:
+    a[0] = coeffs[0];
+    a[1] = 3 * (coeffs[1] - coeffs[0]);
+    a[2] = 3 * (coeffs[0] - 2 * coeffs[1] + coeffs[2]);
+    a[3] = -coeffs[0] + 3 * (coeffs[1] - coeffs[2]) + coeffs[3];
+    break;
+  default:
+    return 0;
+  }
+
+  const double scale = std::max(std::max(fabs(a[0]), fabs(a[1])), std::max(fabs(a[2]), fabs(a[3])));
+  const double zero = 1e-12 * scale;
+  double candidates[3];
+  uint count = 0;
+
+  if (fabs(a[3]) > zero)
+  {
+    // Cardano's method on depressed cubic x^3 + p x + q, where t = x - b / 3
+    double b = a[2] / a[3], c = a[1] / a[3], d = a[0] / a[3];
+    double p = c - b * b / 3;
+    double q = 2 * b * b * b / 27 - b * c / 3 + d;
+    double discriminant = q * q / 4 + p * p * p / 27;
+    if (discriminant > 0)
+    {
+      double sqrt_discriminant = sqrt(discriminant);
+      candidates[count++] = cbrt(-q / 2 + sqrt_discriminant) + cbrt(-q / 2 - sqrt_discriminant) - b / 3;
+    }
+    else if (p == 0)
+    {
+      candidates[count++] = -b / 3;
+    }
+    else
+    {
+      // three real roots, trigonometric form
+      double r = 2 * sqrt(-p / 3);
+      double phi = acos(std::max(-1., std::min(1., 3 * q / (p * r)))) / 3;
+      for (uint k = 0; k < 3; k++)
+        candidates[count++] = r * cos(phi - 2 * M_PI * k / 3) - b / 3;
+    }
+  }
+  else if (fabs(a[2]) > zero)
+  {
+    // numerically stable quadratic formula
+    double discriminant = a[1] * a[1] - 4 * a[2] * a[0];
+    if (discriminant >= 0)
+    {
+      double q = -(a[1] + std::copysign(sqrt(discriminant), a[1])) / 2;
+      candidates[count++] = q / a[2];
+      if (q != 0 && discriminant > 0)
+        candidates[count++] = a[0] / q;
+    }
+  }
+  else if (fabs(a[1]) > zero)
+  {
+    candidates[count++] = -a[0] / a[1];
+  }
+
+  uint found = 0;
+  for (uint k = 0; k < count; k++)
+  {
+    double t = candidates[k];
+    for (uint iter = 0; iter < 2; iter++)
+    {
+      double f = ((a[3] * t + a[2]) * t + a[1]) * t + a[0];
+      double df = (3 * a[3] * t + 2 * a[2]) * t + a[1];
+      if (df != 0)
+        t -= f / df;
+    }
+    if (t >= -1e-12 && t <= 1 + 1e-12)
+      roots[found++] = std::max(0., std::min(1., t));
+  }
+
+  // multiple roots come as several candidates, which polishing leaves only nearly equal
+  std::sort(roots, roots + found);
+  uint unique = 0;
+  for (uint k = 0; k < found; k++)
+    if (unique == 0 || roots[k] - roots[unique - 1] > 1e-7)
+      roots[unique++] = roots[k];
+  return unique;
+}
+
+/*!
+ * \brief Working memory of roots, which can be reused between calls to avoid allocations
+ */
+struct RootsWorkspace
+{
+  /// Interval of parameters with Bernstein coefficients on stack
+  struct Interval
+  {
+    double begin, end;
+    uint depth;
+    bool check_begin; /*! If root at the beginning wasn't already checked by enclosing interval */
+  };
+
+  std::vector<double> coeffs;      /*! Stack of Bernstein coefficients of intervals */
+  std::vector<Interval> intervals; /*! Stack of intervals */
+};
+
+/*!
+ * \brief Find roots of the polynomial with Descartes' rule of signs and subdivision
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param roots Array receiving at most n - 1 roots, in ascending order
+ * \param workspace Working memory, grown as needed and kept for later calls
+ * \param tolerance Precision of resulting roots
+ * \param max_iter Budget of subdivision and refinement steps for the whole polynomial
+ * \return Number of roots in [0, 1]
+ *
+ * Number of sign changes in Bernstein coefficients bounds the number of roots in an interval.
+ * Intervals without sign changes are discarded, intervals with exactly one are refined with
+ * Illinois variant of regula falsi, others are halved with de Casteljau algorithm. Intervals
+ * narrower than tolerance still containing several sign changes are reported as a single
+ * (multiple) root. Worst-case cost is bounded by max_iter; when the budget runs out, roots
+ * not yet isolated are missed. Identically zero polynomial has no isolated roots.
+ */
+inline uint roots(const double* coeffs, uint n, double* roots, RootsWorkspace& workspace, double tolerance = 1e-10,
+                  std::size_t max_iter = 1000)
+{
+  if (n < 2 || std::all_of(coeffs, coeffs + n, [](double c) { return c == 0; }))
+    return 0;
+
+  // depth-first traversal, coefficients of k-th interval on stack are at k * n
+  const uint max_depth = static_cast<uint>(std::min(60., std::max(1., std::ceil(-std::log2(tolerance)))));
+  std::vector<double>& coeffs_stack = workspace.coeffs;
+  std::vector<RootsWorkspace::Interval>& interval_stack = workspace.intervals;
+  if (coeffs_stack.size() < n * (max_depth + 2))
+    coeffs_stack.resize(n * (max_depth + 2));
+  interval_stack.clear();
+  interval_stack.reserve(max_depth + 1);
+  std::copy(coeffs, coeffs + n, coeffs_stack.begin());
+  interval_stack.push_back({0, 1, 0, true});
+
+  uint found = 0;
+  std::size_t iter = 0;
+  while (!interval_stack.empty() && iter < max_iter && found < n - 1)
+  {
+    iter++;
+    RootsWorkspace::Interval interval = interval_stack.back();
+    double* c = &coeffs_stack[(interval_stack.size() - 1) * n];
+    double* next = c + n;
+    const double width = interval.end - interval.begin;
+    interval_stack.pop_back();
+
+    if (interval.check_begin && c[0] == 0)
+      roots[found++] = interval.begin;
+
+    uint variations = 0;
+    double sign = 0;
+    for (uint k = 0; k < n; k++)
+      if (c[k] != 0)
+      {
+        if (sign * c[k] < 0)
+          variations++;
+        sign = c[k];
+      }
+
+    if (variations == 0 || found == n - 1)
+      continue;
+
+    if (variations == 1 && c[0] != 0 && c[n - 1] != 0)
+    {
+      // exactly one root, bracketed by end points
+      double lower = 0, upper = 1, f_lower = c[0], f_upper = c[n - 1], s = 0.5;
+      int side = 0;
+      while ((upper - lower) * width > tolerance && iter < max_iter)
+      {
+        iter++;
+        s = (lower * f_upper - upper * f_lower) / (f_upper - f_lower);
+        double f = deCasteljau(c, n, s, next);
+        if (f == 0)
+          break;
+        if ((f > 0) == (f_lower > 0))
+        {
+          lower = s;
+          f_lower = f;
+          if (side == -1)
+            f_upper /= 2;
+          side = -1;
+        }
+        else
+        {
+          upper = s;
+          f_upper = f;
+          if (side == 1)
+            f_lower /= 2;
+          side = 1;
+        }
+      }
+      roots[found++] = interval.begin + s * width;
+      continue;
+    }
+
+    if (width <= tolerance || interval.depth == max_depth)
+    {
+      roots[found++] = interval.begin + width / 2;
+      continue;
+    }
+
+    // in-place de Casteljau at 0.5 leaves right half in c, left half is collected in next
+    for (uint k = 0; k < n; k++)
+    {
+      next[k] = c[0];
+      for (uint i = 0; i < n - 1 - k; i++)
+        c[i] = (c[i] + c[i + 1]) / 2;
+    }
+    const double middle = interval.begin + width / 2;
+    interval_stack.push_back({middle, interval.end, interval.depth + 1, true});
+    interval_stack.push_back({interval.begin, middle, interval.depth + 1, false});
+  }
+
+  if (coeffs[n - 1] == 0 && found < n - 1 && (found == 0 || roots[found - 1] != 1))
+    roots[found++] = 1;
+  return found;
+}
+
+/*!
+ * \brief Find roots of the polynomial with Descartes' rule of signs and subdivision
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param roots Array receiving at most n - 1 roots, in ascending order
+ * \param tolerance Precision of resulting roots
+ * \param max_iter Budget of subdivision and refinement steps for the whole polynomial
+ * \return Number of roots in [0, 1]
+ *
+ * Same as roots with workspace, which is allocated for this call only.
+ */
+inline uint roots(const double* coeffs, uint n, double* roots, double tolerance = 1e-10, std::size_t max_iter = 1000)
+{
+  RootsWorkspace workspace;
+  return Bernstein::roots(coeffs, n, roots, workspace, tolerance, max_iter);
+}
+
+/*!
+ * \brief Multiply two polynomials in Bernstein basis
+ * \param a Array of n_a Bernstein coefficients of first polynomial
+ * \param n_a Number of coefficients of first polynomial
+ * \param b Array of n_b Bernstein coefficients of second polynomial
+ * \param n_b Number of coefficients of second polynomial
+ * \param product Array receiving n_a + n_b - 1 Bernstein coefficients of the product
+ */
+inline void product(const double* a, uint n_a, const double* b, uint n_b, double* product)
+{
+  const uint m = n_a - 1, n = n_b - 1;
+  std::fill(product, product + m + n + 1, 0.);
+  for (uint i = 0; i <= m; i++)
+    for (uint j = 0; j <= n; j++)
+      product[i + j] += binomial(m, i) * binomial(n, j) * a[i] * b[j];
+  for (uint k = 0; k <= m + n; k++)
+    product[k] /= binomial(m + n, k);
+}
+
+/*!
+ * \brief Evaluate the polynomial for an array of parameters with Horner scheme
+ * \param coeffs Array of n Bernstein coefficients
+ * \param n Number of coefficients
+ * \param t Array of curve parameters
+ * \param count Number of curve parameters
+ * \param result Array for count resulting values
+ *
+ * Parameters are processed in fixed-size blocks kept on stack, where each step of
+ * Horner scheme is an Eigen array operation vectorized over the whole block
+ */
+inline void horner(const double* coeffs, uint n, const double* t, std::size_t count, double* result)
+{
+  typedef Eigen::Array<double, Eigen::Dynamic, 1, 0, batch_size, 1> Block;
+
+  const uint degree = n - 1;
+  for (std::size_t begin = 0; begin < count; begin += batch_size)
+  {
+    const Eigen::Index size = static_cast<Eigen::Index>(std::min<std::size_t>(batch_size, count - begin));
+    Eigen::Map<const Eigen::ArrayXd> t_block(t + begin, size);
+    Eigen::Map<Eigen::ArrayXd> result_block(result + begin, size);
+    if (n <= 1)
+    {
+      result_block.setConstant(n == 0 ? 0 : coeffs[0]);
+      continue;
+    }
+
+    Block u = 1 - t_block;
+    Block t_power = Block::Ones(size);
+    double binomial_coeff = 1;
+    Block value = coeffs[0] * u;
+    for (uint k = 1; k < degree; k++)
+    {
+      t_power *= t_block;
+      binomial_coeff = binomial_coeff * (degree - k + 1) / k;
+      value = (value + (binomial_coeff * coeffs[k]) * t_power) * u;
+    }
+    result_block = value + coeffs[degree] * t_power * t_block;
+  }
+}
+}
+}
+
+#endif // BERNSTEIN_H
@@ -1,118 +1,122 @@
 #include "bezier.h"
-
-inline double binomial(uint n, uint k) { return tgamma(n + 1) / (tgamma(k + 1) * tgamma(n - k + 1)); }
+#include "bernstein.h"
+#include "parallel.h"
 
 namespace Bezier
 {
+using Bernstein::binomial;
 
-Curve::CoeffsMap Curve::bernstein_coeffs_ = CoeffsMap();
-Curve::CoeffsMap Curve::splitting_coeffs_left_ = CoeffsMap();
-Curve::CoeffsMap Curve::splitting_coeffs_right_ = CoeffsMap();
-Curve::CoeffsMap Curve::elevate_order_coeffs_ = CoeffsMap();
-Curve::CoeffsMap Curve::lower_order_coeffs_ = CoeffsMap();
+void Curve::resetCache() { cache_.reset(); }
 
-void Curve::resetCache()
+std::shared_ptr<Curve::Cache> Curve::getCache() const
 {
-  cached_derivative_.reset();
-  cached_ext_points_.reset();
-  cached_bounding_box_tight_.reset();
-  cached_bounding_box_relaxed_.reset();
-  cached_polyline_.reset();
-}
+  if (!caching_)
+    return nullptr;
 
-Curve::Coeffs Curve::bernsteinCoeffs() const
-{
-  if (bernstein_coeffs_.find(N_) == bernstein_coeffs_.end())
+  auto cache = std::atomic_load(&cache_);
+  if (!cache)
   {
-    bernstein_coeffs_.insert(std::make_pair(N_, Coeffs::Zero(N_, N_)));
-    for (uint k = 0; k < N_; k++)
-      for (uint i = 0; i <= k; i++)
-        bernstein_coeffs_.at(N_)(k, i) = pow(-1, i - k) * binomial(N_ - 1, k) * binomial(k, i);
+    // if another thread created the cache in the meantime, use that one
+    auto new_cache = std::make_shared<Cache>();
+    if (std::atomic_compare_exchange_strong(&cache_, &cache, new_cache))
+      cache = new_cache;
   }
-  return bernstein_coeffs_.at(N_);
+  return cache;
 }
 
-Curve::Coeffs Curve::splittingCoeffsLeft(double z) const
+template <typename T, typename Generator>
+T Curve::cached(std::shared_ptr<T> Cache::*member, Generator generate) const
 {
-  Curve::Coeffs coeffs(Coeffs::Zero(N_, N_));
-  if (z == 0.5)
+  auto cache = getCache();
+  if (!cache)
+    return generate();
+
+  auto data = std::atomic_load(&(cache.get()->*member));
+  if (!data)
   {
-    if (splitting_coeffs_left_.find(N_) == splitting_coeffs_left_.end())
-    {
-      splitting_coeffs_left_.insert(std::make_pair(N_, Coeffs::Zero(N_, N_)));
-      for (uint k = 0; k < N_; k++)
-        splitting_coeffs_left_.at(N_)(k, k) = pow(0.5, k);
-      splitting_coeffs_left_.at(N_) =
-          bernsteinCoeffs().inverse() * splitting_coeffs_left_.at(N_) * bernsteinCoeffs();
-    }
-    coeffs = splitting_coeffs_left_.at(N_);
+    data = std::make_shared<T>(generate());
+    std::atomic_store(&(cache.get()->*member), data);
   }
-  else
-  {
-    for (uint k = 0; k < N_; k++)
-      coeffs(k, k) = pow(z, k);
-    coeffs = bernsteinCoeffs().inverse() * coeffs * bernsteinCoeffs();
-  }
-  return coeffs;
+  return *data;
 }
 
-Curve::Coeffs Curve::splittingCoeffsRight(double z) const
+Curve::CoeffsCache::CoeffsCache(Generator generator, uint first) : generator_(generator), first_(first)
 {
-  Curve::Coeffs coeffs(Coeffs::Zero(N_, N_));
-  if (z == 0.5)
-  {
-    if (splitting_coeffs_right_.find(N_) == splitting_coeffs_right_.end())
-    {
-      splitting_coeffs_right_.insert(std::make_pair(N_, Coeffs::Zero(N_, N_)));
-      for (uint k = 0; k < N_; k++)
-        for (uint i = 0; i <= k; i++)
-          splitting_coeffs_right_.at(N_)(N_ - 1 - k, N_ - 1 - (k - i)) = splittingCoeffsLeft()(k, i);
-    }
-    coeffs = splitting_coeffs_right_.at(N_);
-  }
-  else
-  {
-    for (uint k = 0; k < N_; k++)
-      for (uint i = 0; i <= k; i++)
-        coeffs(N_ - 1 - k, N_ - 1 - (k - i)) = splittingCoeffsLeft(z)(k, i);
-  }
+  for (uint n = first_; n <= BEZIER_PRECOMPUTED_ORDER + 1; n++)
+    precomputed_.push_back(generator_(n));
+}
+
+const Curve::Coeffs& Curve::CoeffsCache::at(uint n) const
+{
+  if (n - first_ < precomputed_.size())
+    return precomputed_[n - first_];
+
+  // std::map never invalidates references to its elements, so they can be used after unlocking
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (computed_.find(n) == computed_.end())
+    computed_.insert(std::make_pair(n, generator_(n)));
+  return computed_.at(n);
+}
+
+const Curve::CoeffsCache& Curve::bernsteinCache()
+{
+  static const CoeffsCache cache(&createBernsteinCoeffs, 1);
+  return cache;
+}
+
+const Curve::CoeffsCache& Curve::elevateOrderCache()
+{
+  static const CoeffsCache cache(&createElevateOrderCoeffs, 1);
+  return cache;
+}
+
+const Curve::CoeffsCache& Curve::lowerOrderCache()
+{
+  static const CoeffsCache cache(&createLowerOrderCoeffs, 2);
+  return cache;
+}
+
+const bool Curve::static_cache_ready_ = (bernsteinCache(), elevateOrderCache(), lowerOrderCache(), true);
+
+Curve::Coeffs Curve::createBernsteinCoeffs(uint n)
+{
+  Coeffs coeffs(Coeffs::Zero(n, n));
+  for (uint k = 0; k < n; k++)
+    for (uint i = 0; i <= k; i++)
+      coeffs(k, i) = ((k - i) % 2 ? -1 : 1) * binomial(n - 1, k) * binomial(k, i);
   return coeffs;
 }
 
-Curve::Coeffs Curve::elevateOrderCoeffs(uint n) const
+Curve::Coeffs Curve::createElevateOrderCoeffs(uint n)
 {
-  if (elevate_order_coeffs_.find(n) == elevate_order_coeffs_.end())
+  Coeffs coeffs(Coeffs::Zero(n + 1, n));
+  for (uint k = 0; k < n + 1; k++)
   {
-    elevate_order_coeffs_.insert(std::make_pair(n, Coeffs::Zero(n + 1, n)));
-    for (uint k = 0; k < n + 1; k++)
+    if (k == 0)
+      coeffs(k, 0) = 1;
+    else if (k == n)
+      coeffs(k, k - 1) = 1;
+    else
     {
-      if (k == 0)
-        elevate_order_coeffs_.at(n)(k, 0) = 1;
-      else if (k == n)
-        elevate_order_coeffs_.at(n)(k, k - 1) = 1;
-      else
-      {
-        elevate_order_coeffs_.at(n)(k, k - 1) = 1. * k / n;
-        elevate_order_coeffs_.at(n)(k, k) = 1 - 1. * k / n;
-      }
+      coeffs(k, k - 1) = 1. * k / n;
+      coeffs(k, k) = 1 - 1. * k / n;
     }
   }
-  return elevate_order_coeffs_.at(n);
+  return coeffs;
 }
 
-Curve::Coeffs Curve::lowerOrderCoeffs(uint n) const
+Curve::Coeffs Curve::createLowerOrderCoeffs(uint n)
 {
-  if (lower_order_coeffs_.find(n) == lower_order_coeffs_.end())
-  {
-    lower_order_coeffs_.insert(std::make_pair(n, Coeffs::Zero(n - 1, n)));
-    lower_order_coeffs_.at(n).noalias() =
-        (elevateOrderCoeffs(n - 1).transpose() * elevateOrderCoeffs(n - 1)).inverse() *
-        elevateOrderCoeffs(n - 1).transpose();
-  }
-
-  return lower_order_coeffs_.at(n);
+  const Coeffs& elevate = elevateOrderCache().at(n - 1);
+  return (elevate.transpose() * elevate).inverse() * elevate.transpose();
 }
 
+const Curve::Coeffs& Curve::bernsteinCoeffs() const { return bernsteinCache().at(N_); }
+
+const Curve::Coeffs& Curve::elevateOrderCoeffs(uint n) const { return elevateOrderCache().at(n); }
+
+const Curve::Coeffs& Curve::lowerOrderCoeffs(uint n) const { return lowerOrderCache().at(n); }
+
 Curve::Curve(const Eigen::MatrixX2d& points)
 {
   N_ = static_cast<uint>(points.rows());
@@ -127,6 +131,33 @@ Curve::Curve(const PointVector& points)
     control_points_.row(k) = points.at(k);
 }
 
+Curve::Curve(const Curve& curve)
+    : std::enable_shared_from_this<Curve>(curve), N_(curve.N_), evaluation_method_(curve.evaluation_method_),
+      caching_(curve.caching_), control_points_(curve.control_points_), cache_(std::atomic_load(&curve.cache_))
+{
+}
+
+Curve& Curve::operator=(const Curve& curve)
+{
+  if (this != &curve)
+  {
+    N_ = curve.N_;
+    evaluation_method_ = curve.evaluation_method_;
+    caching_ = curve.caching_;
+    control_points_ = curve.control_points_;
+    cache_ = std::atomic_load(&curve.cache_);
+  }
+  return *this;
+}
+
+void Curve::setCachingEnabled(bool enabled)
+{
+  caching_ = enabled;
+  resetCache();
+}
+
+bool Curve::isCachingEnabled() const { return caching_; }
+
 PointVector Curve::getControlPoints() const
 {
   PointVector points(N_);
@@ -135,38 +166,105 @@ PointVector Curve::getControlPoints() const
   return points;
 }
 
-PointVector Curve::getPolyline(double smoothness, double precision) const
+std::shared_ptr<const Curve::Polyline> Curve::findPolyline(double smoothness, double precision,
+                                                          double tolerance) const
 {
-  if (!cached_polyline_ || smoothness != cached_polyline_smootheness_)
+  // lookup alone doesn't create the cache
+  auto cache = caching_ ? std::atomic_load(&cache_) : nullptr;
+  std::shared_ptr<PolylineLevels> levels;
+  if (cache)
+    levels = std::atomic_load(&cache->polylines);
+  if (levels)
+    for (auto&& level : *levels)
+      if (level->smoothness == smoothness && level->precision == precision && level->tolerance == tolerance)
+        return level;
+  return nullptr;
+}
+
+PointVector Curve::cachedPolyline(double smoothness, double precision, double tolerance) const
+{
+  if (auto polyline = findPolyline(smoothness, precision, tolerance))
+    return polyline->points;
+
+  auto matches = [=](const Polyline& polyline)
   {
-    PointVector* polyline = new PointVector;
-    std::vector<std::shared_ptr<Curve>> subcurves;
-    subcurves.push_back(std::make_shared<Bezier::Curve>(this->getControlPoints()));
-    polyline->push_back(control_points_.row(0));
-    while (!subcurves.empty())
-    {
-      auto c = subcurves.back();
-      subcurves.pop_back();
-      auto cp = c->getControlPoints();
-      double hull = 0;
-      for (uint k = 1; k < cp.size(); k++)
-        hull += (cp.at(k - 1) - cp.at(k)).norm();
-      if (hull < smoothness * (cp.front() - cp.back()).norm() ||
-          (cp.front() - cp.back()).norm() / smoothness < precision)
-      {
-        polyline->push_back(cp.back());
-      }
-      else
-      {
-        auto split = c->splitCurve();
-        subcurves.push_back(std::make_shared<Bezier::Curve>(split.second));
-        subcurves.push_back(std::make_shared<Bezier::Curve>(split.first));
-      }
-    }
-    (const_cast<Curve*>(this))->cached_polyline_smootheness_ = smoothness;
-    (const_cast<Curve*>(this))->cached_polyline_.reset(polyline);
+    return polyline.smoothness == smoothness && polyline.precision == precision && polyline.tolerance == tolerance;
+  };
+
+  auto cache = getCache();
+  std::shared_ptr<PolylineLevels> levels;
+  if (cache)
+    levels = std::atomic_load(&cache->polylines);
+
+  // polyline within tolerance can be simplified from the closest one at most half as coarse
+  std::shared_ptr<const Polyline> finer;
+  if (tolerance > 0 && levels)
+    for (auto&& level : *levels)
+      if (level->tolerance > 0 && level->tolerance <= tolerance / 2 && (!finer || level->tolerance > finer->tolerance))
+        finer = level;
+
+  auto new_polyline = std::make_shared<Polyline>();
+  new_polyline->smoothness = smoothness;
+  new_polyline->precision = precision;
+  new_polyline->tolerance = tolerance;
+  if (finer)
+    Flattening::simplify(finer->points.begin(), finer->points.end(), std::back_inserter(new_polyline->points),
+                         tolerance - finer->tolerance);
+  else if (tolerance > 0)
+    writePolylineWithTolerance(std::back_inserter(new_polyline->points), tolerance);
+  else
+    writePolyline(std::back_inserter(new_polyline->points), smoothness, precision);
+
+  if (cache)
+  {
+    // copy-on-write, least recently generated polylines are dropped
+    auto new_levels = std::make_shared<PolylineLevels>(1, new_polyline);
+    if (levels)
+      for (auto&& level : *levels)
+        if (new_levels->size() < max_cached_polylines && !matches(*level))
+          new_levels->push_back(level);
+    std::atomic_store(&cache->polylines, new_levels);
   }
-  return *cached_polyline_;
+  return new_polyline->points;
+}
+
+std::shared_ptr<const Curve::ProjectionTable> Curve::projectionTable() const
+{
+  auto cache = getCache();
+  std::shared_ptr<ProjectionTable> table;
+  if (cache)
+    table = std::atomic_load(&cache->projection);
+  if (table)
+    return table;
+
+  // enough samples for closest one to lie within basin of global minimum for all but near-ambiguous points
+  const uint samples_per_segment = 16;
+  table = std::make_shared<ProjectionTable>();
+  const uint count = samples_per_segment * (N_ - 1) + 1;
+  Eigen::VectorXd t = Eigen::VectorXd::LinSpaced(count, 0, 1);
+  table->samples.resize(count, 2);
+  valueAt(t.data(), count, table->samples.col(0).data(), table->samples.col(1).data());
+
+  table->derivative = (N_ - 1) * (control_points_.bottomRows(N_ - 1) - control_points_.topRows(N_ - 1));
+  if (N_ > 2)
+    table->second_derivative =
+        (N_ - 2) * (table->derivative.bottomRows(N_ - 2) - table->derivative.topRows(N_ - 2));
+
+  if (cache)
+    std::atomic_store(&cache->projection, table);
+  return table;
+}
+
+PointVector Curve::getPolyline(double smoothness, double precision) const
+{
+  return cachedPolyline(smoothness, precision, 0);
+}
+
+PointVector Curve::getPolylineWithTolerance(double tolerance) const
+{
+  if (tolerance <= 0)
+    throw "Tolerance must be positive.";
+  return cachedPolyline(0, 0, tolerance);
 }
 
 void Curve::manipulateControlPoint(uint index, const Point& point)
@@ -224,14 +322,64 @@ void Curve::lowerOrder()
   resetCache();
 }
 
-Point Curve::valueAt(double t) const
+void Curve::setEvaluationMethod(EvaluationMethod method) { evaluation_method_ = method; }
+
+EvaluationMethod Curve::getEvaluationMethod() const { return evaluation_method_; }
+
+Point Curve::valueAt(double t) const { return valueAt(t, evaluation_method_); }
+
+Point Curve::valueAt(double t, EvaluationMethod method) const
 {
-  Eigen::VectorXd power_basis;
-  power_basis.resize(N_);
-  for (uint k = 0; k < N_; k++)
-    power_basis(k) = pow(t, k);
+  const double* x = control_points_.col(0).data();
+  const double* y = control_points_.col(1).data();
 
-  return (power_basis.transpose() * bernsteinCoeffs() * control_points_).transpose();
+  switch (method)
+  {
+  case EvaluationMethod::PowerBasis:
+  {
+    Eigen::RowVectorXd power_basis;
+    power_basis.resize(N_);
+    for (uint k = 0; k < N_; k++)
+      power_basis(k) = pow(t, k);
+
+    Eigen::RowVectorXd weights;
+    weights.noalias() = power_basis * bernsteinCoeffs();
+    return (weights * control_points_).transpose();
+  }
+  case EvaluationMethod::DeCasteljau:
+  {
+    // keep working memory on stack, unless the curve is unusually large
+    double stack_scratch[Bernstein::max_stack_coeffs];
+    std::vector<double> heap_scratch;
+    double* scratch = stack_scratch;
+    if (N_ > Bernstein::max_stack_coeffs)
+    {
+      heap_scratch.resize(N_);
+      scratch = heap_scratch.data();
+    }
+    return Point(Bernstein::deCasteljau(x, N_, t, scratch), Bernstein::deCasteljau(y, N_, t, scratch));
+  }
+  case EvaluationMethod::Horner:
+  default:
+    return Point(Bernstein::horner(x, N_, t), Bernstein::horner(y, N_, t));
+  }
+}
+
+PointVector Curve::valueAt(const std::vector<double>& t_vector) const
+{
+  Eigen::MatrixX2d points(t_vector.size(), 2);
+  valueAt(t_vector.data(), t_vector.size(), points.col(0).data(), points.col(1).data());
+
+  PointVector result(t_vector.size());
+  for (uint k = 0; k < result.size(); k++)
+    result.at(k) = points.row(k);
+  return result;
+}
+
+void Curve::valueAt(const double* t, std::size_t count, double* x, double* y) const
+{
+  Bernstein::horner(control_points_.col(0).data(), N_, t, count, x);
+  Bernstein::horner(control_points_.col(1).data(), N_, t, count, y);
 }
 
 double Curve::curvatureAt(double t) const
@@ -252,83 +400,92 @@ Vec2 Curve::tangentAt(double t, bool normalize) const
   return p;
 }
 
+std::vector<Vec2> Curve::tangentAt(const std::vector<double>& t_vector, bool normalize) const
+{
+  std::vector<Vec2> tangents(getDerivative().valueAt(t_vector));
+  if (normalize)
+    for (auto& tangent : tangents)
+      tangent.normalize();
+  return tangents;
+}
+
 Vec2 Curve::normalAt(double t, bool normalize) const
 {
   Point tangent = tangentAt(t, normalize);
   return Vec2(-tangent.y(), tangent.x());
 }
 
+std::vector<Vec2> Curve::normalAt(const std::vector<double>& t_vector, bool normalize) const
+{
+  std::vector<Vec2> normals(tangentAt(t_vector, normalize));
+  for (auto& normal : normals)
+    normal = Vec2(-normal.y(), normal.x());
+  return normals;
+}
+
 Curve Curve::getDerivative() const
 {
-  if (!cached_derivative_)
+  auto derive = [this]()
   {
     Eigen::MatrixX2d new_points;
     new_points.resize(N_ - 1, 2);
     for (uint k = 0; k < N_ - 1; k++)
-      new_points.row(k).noalias() = N_ * (control_points_.row(k + 1) - control_points_.row(k));
+      new_points.row(k).noalias() = (N_ - 1) * (control_points_.row(k + 1) - control_points_.row(k));
+    return Curve(new_points);
+  };
+  return cached(&Cache::derivative, derive);
+}
+
+std::vector<double> Curve::extremeParameters(double epsilon, std::size_t max_iter) const
+{
+  std::vector<double> parameters;
+  if (N_ < 3)
+    return parameters;
 
-    (const_cast<Curve*>(this))->cached_derivative_ = std::make_shared<Curve>(new_points);
+  // Bernstein coefficients of derivative, scaling is irrelevant for roots
+  Eigen::MatrixX2d derivative = control_points_.bottomRows(N_ - 1) - control_points_.topRows(N_ - 1);
+  std::vector<double> roots(N_ - 2);
+
+  // check both axes
+  for (long k = 0; k < 2; k++)
+  {
+    // up to quartic curves derivative is at most cubic, with closed-form roots
+    uint count = N_ <= 5 ? Bernstein::rootsClosedForm(derivative.col(k).data(), N_ - 1, roots.data())
+                         : Bernstein::roots(derivative.col(k).data(), N_ - 1, roots.data(), epsilon, max_iter);
+    parameters.insert(parameters.end(), roots.begin(), roots.begin() + count);
   }
-  return *cached_derivative_;
+  return parameters;
 }
 
-std::vector<Point> Curve::getRoots(double step, double epsilon, std::size_t max_iter) const
+std::vector<Point> Curve::getRoots() const
 {
-  if (!cached_ext_points_)
+  auto find_roots = [this]()
   {
-    (const_cast<Curve*>(this))->cached_ext_points_ = std::make_shared<std::vector<Point>>();
-    std::vector<double> added_t;
+    std::vector<Point> ext_points;
+    for (double t : extremeParameters())
+      ext_points.push_back(valueAt(t));
+    return ext_points;
+  };
+  return cached(&Cache::ext_points, find_roots);
+}
 
-    // check both axes
-    for (long k = 0; k < 2; k++)
-    {
-      double t = 0;
-      while (t <= 1.0)
-      {
-        double t_current = t;
-        std::size_t current_iter = 0;
+std::vector<Point> Curve::getRoots(double, double epsilon, std::size_t) const { return getExtremes(epsilon); }
 
-        // it has to converge in max_iter steps
-        while (current_iter < max_iter)
-        {
-          // Newton-Rhapson: f = f - f' / f''
-          double t_new =
-              t_current - getDerivative().valueAt(t_current)[k] / getDerivative().getDerivative().valueAt(t_current)[k];
-
-          // if there is no change to t_current
-          if (fabs(t_new - t_current) < epsilon)
-          {
-            // check if between [0, 1]
-            if (t_new >= -epsilon && t_new <= 1 + epsilon)
-            {
-              // check if same value wasn't found before
-              if (added_t.end() == std::find_if(added_t.begin(), added_t.end(), [t_new, epsilon](const double& val)
-                                                {
-                                                  return fabs(val - t_new) < epsilon;
-                                                }))
-              {
-                // add new value and point
-                added_t.push_back(t_new);
-                (const_cast<Curve*>(this))->cached_ext_points_->push_back(valueAt(t_new));
-                break;
-              }
-            }
-          }
-
-          t_current = t_new;
-          current_iter++;
-        }
+std::vector<Point> Curve::getExtremes(double epsilon, std::size_t max_iter) const
+{
+  // cache holds only extremes with default precision
+  if (epsilon == extremes_epsilon && max_iter == extremes_max_iter)
+    return getRoots();
 
-        t += step;
-      }
-    }
-  }
-  return *cached_ext_points_;
+  std::vector<Point> ext_points;
+  for (double t : extremeParameters(epsilon, max_iter))
+    ext_points.push_back(valueAt(t));
+  return ext_points;
 }
 
 BBox Curve::getBBox(bool use_roots) const
 {
-  if (!(use_roots ? cached_bounding_box_tight_ : cached_bounding_box_relaxed_))
+  auto find_bbox = [&]()
   {
     std::vector<Point> extremes;
     if (use_roots)
@@ -352,170 +509,699 @@ BBox Curve::getBBox(bool use_roots) const
                                           {
                                             return lhs.y() < rhs.y();
                                           });
-    if (use_roots)
-      (const_cast<Curve*>(this))->cached_bounding_box_tight_ = std::make_shared<BBox>(
-          Point(x_extremes.first->x(), y_extremes.first->y()), Point(x_extremes.second->x(), y_extremes.second->y()));
-    else
-      (const_cast<Curve*>(this))->cached_bounding_box_relaxed_ = std::make_shared<BBox>(
-          Point(x_extremes.first->x(), y_extremes.first->y()), Point(x_extremes.second->x(), y_extremes.second->y()));
-  }
-  return *(use_roots ? cached_bounding_box_tight_ : cached_bounding_box_relaxed_);
+    return BBox(Point(x_extremes.first->x(), y_extremes.first->y()),
+                Point(x_extremes.second->x(), y_extremes.second->y()));
+  };
+  return cached(use_roots ? &Cache::bounding_box_tight : &Cache::bounding_box_relaxed, find_bbox);
 }
 
 std::pair<Curve, Curve> Curve::splitCurve(double z) const
 {
-  return std::make_pair(Curve(splittingCoeffsLeft(z) * control_points_),
-                        Curve(splittingCoeffsRight(z) * control_points_));
+  Eigen::MatrixX2d left(N_, 2), right(N_, 2);
+  for (long k = 0; k < 2; k++)
+    Bernstein::split(control_points_.col(k).data(), N_, z, left.col(k).data(), right.col(k).data());
+  return std::make_pair(Curve(left), Curve(right));
+}
+
+void Curve::splitCurve(Curve& left, Curve& right, double z) const
+{
+  left.control_points_.resize(N_, 2);
+  right.control_points_.resize(N_, 2);
+  for (long k = 0; k < 2; k++)
+    Bernstein::split(control_points_.col(k).data(), N_, z, left.control_points_.col(k).data(),
+                     right.control_points_.col(k).data());
+  left.N_ = right.N_ = N_;
+  left.resetCache();
+  right.resetCache();
+}
+
+Curve Curve::subCurve(double t0, double t1) const
+{
+  Eigen::MatrixX2d points(N_, 2);
+  Eigen::VectorXd scratch(N_);
+  for (long k = 0; k < 2; k++)
+    Bernstein::interval(control_points_.col(k).data(), N_, t0, t1, points.col(k).data(), scratch.data());
+  return Curve(points);
 }
 
-std::vector<Point> Curve::getPointsOfIntersection(const Curve& curve, bool stop_at_first, double epsilon) const
+std::vector<Point> Curve::getPointsOfIntersection(const Curve& curve, bool stop_at_first, double epsilon,
+                                                  IntersectionMethod method) const
 {
   std::vector<Point> points_of_intersection;
-  std::vector<std::pair<std::shared_ptr<const Curve>, std::shared_ptr<const Curve>>> subcurve_pairs;
+  for (auto&& intersection : this == &curve ? getSelfIntersections(epsilon)
+                             : method == IntersectionMethod::BezierClipping
+                                 ? clipIntersections(curve, stop_at_first, epsilon)
+                                 : subdivideIntersections(curve, stop_at_first, epsilon))
+  {
+    points_of_intersection.push_back(intersection.point);
+    if (stop_at_first)
+      break;
+  }
+  return points_of_intersection;
+}
 
-  if (this != &curve)
+std::vector<Intersection> Curve::getIntersections(const Curve& curve, double epsilon, IntersectionMethod method) const
+{
+  if (this == &curve)
+    return getSelfIntersections(epsilon);
+  if (method == IntersectionMethod::BezierClipping)
+    return clipIntersections(curve, false, epsilon);
+  return subdivideIntersections(curve, false, epsilon);
+}
+
+namespace
+{
+/// Add intersection if the same point wasn't found before, return true if added
+bool addIntersection(std::vector<Intersection>& intersections, const Intersection& new_intersection,
+                     double epsilon)
+{
+  if (intersections.end() != std::find_if(intersections.begin(), intersections.end(),
+                                          [&new_intersection, epsilon](const Intersection& intersection)
+                                          {
+                                            return (intersection.point - new_intersection.point).norm() < epsilon;
+                                          }))
+    return false;
+  intersections.push_back(new_intersection);
+  return true;
+}
+
+/*!
+ * \brief Stack of pairs of subcurves for intersection algorithms
+ *
+ * All pairs are kept in a single buffer, each as a block of raw values: coordinates of
+ * control points of both subcurves, followed by parameter range on original curve and
+ * bounding box of each subcurve. Buffer grows geometrically and is never shrunk, so
+ * a whole traversal performs only a few allocations.
+ */
+class SubcurvePairs
+{
+private:
+  uint n_[2];                /*! Number of control points of first and second subcurves */
+  std::size_t stride_;       /*! Number of values per pair */
+  std::size_t size_ = 0;     /*! Number of pairs on stack */
+  std::vector<double> data_; /*! Buffer with all pairs */
+
+public:
+  /// Reserve space for given number of pairs
+  SubcurvePairs(uint n, uint m, std::size_t capacity)
+      : n_{n, m}, stride_(2 * (n + m) + 12), data_(capacity * stride_)
   {
-    // we don't know if shared_ptr of "this" and "curve" exists
-    // if not, make temporary copies and use them
-    subcurve_pairs.push_back(std::make_pair(std::shared_ptr<Curve>(), std::shared_ptr<Curve>()));
-    try // for "this"
-    {
-      subcurve_pairs.front().first = this->shared_from_this();
-    }
-    catch (std::bad_weak_ptr const&)
-    {
-      subcurve_pairs.front().first = std::make_shared<const Curve>(*this);
-    }
-    try // for "curve"
-    {
-      subcurve_pairs.front().second = curve.shared_from_this();
-    }
-    catch (std::bad_weak_ptr const&)
+  }
+
+  /// Number of values per pair
+  std::size_t stride() const { return stride_; }
+  /// Number of control points of subcurve
+  uint count(uint part) const { return n_[part]; }
+  /// If there are no pairs on stack
+  bool empty() const { return size_ == 0; }
+  /// Last pair on stack (invalidated by push)
+  double* top() { return &data_[(size_ - 1) * stride_]; }
+  /// Remove last pair
+  void pop() { size_--; }
+  /// Add an uninitialized pair and return it (invalidates previous pointers)
+  double* push()
+  {
+    if ((size_ + 1) * stride_ > data_.size())
+      data_.resize(2 * data_.size() + stride_);
+    return &data_[size_++ * stride_];
+  }
+
+  /// x coordinates of subcurve (part 0 or 1) within a pair
+  double* x(double* pair, uint part) const { return pair + (part ? 2 * n_[0] : 0); }
+  /// y coordinates of subcurve within a pair
+  double* y(double* pair, uint part) const { return pair + (part ? 2 * n_[0] + n_[1] : n_[0]); }
+  /// Parameter range (begin, end) followed by bounding box (min x, min y, max x, max y) of subcurve
+  double* range(double* pair, uint part) const { return pair + 2 * (n_[0] + n_[1]) + (part ? 6 : 0); }
+  /// Bounding box of subcurve
+  BBox bbox(double* pair, uint part) const
+  {
+    const double* r = range(pair, part);
+    return BBox(Point(r[2], r[3]), Point(r[4], r[5]));
+  }
+  /// Midpoint of parameter range of subcurve
+  double middle(double* pair, uint part) const { return (range(pair, part)[0] + range(pair, part)[1]) / 2; }
+
+  /// Recompute bounding box of subcurve from its control points
+  void updateBBox(double* pair, uint part) const
+  {
+    const double *px = x(pair, part), *py = y(pair, part);
+    double* r = range(pair, part);
+    r[2] = *std::min_element(px, px + n_[part]);
+    r[3] = *std::min_element(py, py + n_[part]);
+    r[4] = *std::max_element(px, px + n_[part]);
+    r[5] = *std::max_element(py, py + n_[part]);
+  }
+
+  /// Set subcurve within a pair
+  void set(double* pair, uint part, const double* px, const double* py, double begin, double end) const
+  {
+    std::copy(px, px + n_[part], x(pair, part));
+    std::copy(py, py + n_[part], y(pair, part));
+    range(pair, part)[0] = begin;
+    range(pair, part)[1] = end;
+    updateBBox(pair, part);
+  }
+
+  /*!
+   * \brief Halve subcurve of a pair
+   * \param pair Pair with subcurve
+   * \param part Index of subcurve
+   * \param halves Buffer for 4 n values receiving x, y of left and then x, y of right half
+   */
+  void halve(double* pair, uint part, double* halves) const
+  {
+    const uint n = n_[part];
+    std::copy(x(pair, part), x(pair, part) + n, halves + 2 * n);
+    std::copy(y(pair, part), y(pair, part) + n, halves + 3 * n);
+    Bernstein::split(halves + 2 * n, n, 0.5, halves, halves + 2 * n);
+    Bernstein::split(halves + 3 * n, n, 0.5, halves + n, halves + 3 * n);
+  }
+};
+}
+
+std::vector<Intersection> Curve::getSelfIntersections(double epsilon) const
+{
+  std::vector<Intersection> intersections;
+
+  // lines and parabolas cannot intersect themselves
+  if (N_ < 4)
+    return intersections;
+
+  if (N_ == 4)
+  {
+    // B(t) = a t^3 + b t^2 + c t + d, and B(t1) = B(t2) for t1 != t2 gives
+    // a (s^2 - p) + b s + c = 0, where s = t1 + t2 and p = t1 t2
+    const Vec2 p0 = control_points_.row(0), p1 = control_points_.row(1), p2 = control_points_.row(2),
+               p3 = control_points_.row(3);
+    const Vec2 a = -p0 + 3 * p1 - 3 * p2 + p3, b = 3 * p0 - 6 * p1 + 3 * p2, c = 3 * (p1 - p0);
+    auto cross = [](const Vec2& u, const Vec2& v) { return u.x() * v.y() - u.y() * v.x(); };
+
+    // cross product with a eliminates p
+    const double a_cross_b = cross(a, b);
+    if (fabs(a_cross_b) <= 1e-12 * a.norm() * b.norm())
+      return intersections;
+    const double s = -cross(a, c) / a_cross_b;
+    const long k = fabs(a.x()) > fabs(a.y()) ? 0 : 1;
+    const double p = s * s + (b(k) * s + c(k)) / a(k);
+
+    // t1 and t2 are roots of t^2 - s t + p
+    const double discriminant = s * s - 4 * p;
+    if (discriminant > 0)
     {
-      subcurve_pairs.front().second = std::make_shared<const Curve>(curve);
+      const double t1 = (s - sqrt(discriminant)) / 2, t2 = (s + sqrt(discriminant)) / 2;
+      if (t1 >= 0 && t2 <= 1)
+        intersections.push_back(Intersection{t1, t2, valueAt(t1)});
     }
+    return intersections;
   }
-  else
+
+  // split at extremes into pieces monotone in both axes, which cannot intersect themselves;
+  // adjacent pieces are together monotone in one axis, so only other pairs can intersect
+  std::vector<double> splits = extremeParameters();
+  splits.push_back(0);
+  splits.push_back(1);
+  std::sort(splits.begin(), splits.end());
+  // extremes of both axes at a cusp differ slightly, a sliver between them would let pieces
+  // that aren't adjacent touch, so splits closer than epsilon on curve are merged
+  splits.erase(std::unique(splits.begin(), splits.end(),
+                           [this, epsilon](double t1, double t2)
+                           { return t2 - t1 < 1e-9 || (valueAt(t2) - valueAt(t1)).norm() < epsilon; }),
+               splits.end());
+  splits.back() = 1;
+
+  std::vector<Curve> pieces;
+  for (std::size_t k = 0; k + 1 < splits.size(); k++)
   {
-    // TODO: self-interserction
+    pieces.push_back(subCurve(splits[k], splits[k + 1]));
+    pieces.back().setCachingEnabled(false);
   }
 
-  while (!subcurve_pairs.empty())
+  for (std::size_t i = 0; i < pieces.size(); i++)
+    for (std::size_t j = i + 2; j < pieces.size(); j++)
+      for (auto&& intersection : pieces[i].clipIntersections(pieces[j], false, epsilon))
+      {
+        const double t1 = splits[i] + intersection.t1 * (splits[i + 1] - splits[i]);
+        const double t2 = splits[j] + intersection.t2 * (splits[j + 1] - splits[j]);
+        addIntersection(intersections, Intersection{t1, t2, intersection.point}, epsilon);
+      }
+  return intersections;
+}
+
+std::vector<Intersection> Curve::getLineIntersections(const Point& p1, const Point& p2, LineType type,
+                                                     double epsilon) const
+{
+  const Vec2 direction = p2 - p1;
+  const double length = direction.squaredNorm();
+  if (length == 0)
+    throw "Line must be defined by two distinct points.";
+
+  // keep distances and roots on stack, unless the curve is unusually large
+  double stack_buffer[2 * Bernstein::max_stack_coeffs];
+  std::vector<double> heap_buffer;
+  double* distances = stack_buffer;
+  if (N_ > Bernstein::max_stack_coeffs)
   {
-    std::shared_ptr<const Curve> part_a = std::get<0>(subcurve_pairs.back());
-    std::shared_ptr<const Curve> part_b = std::get<1>(subcurve_pairs.back());
-    subcurve_pairs.pop_back();
+    heap_buffer.resize(2 * N_);
+    distances = heap_buffer.data();
+  }
+  double* roots = distances + N_;
+
+  // signed distances from line, scaled by its length
+  for (uint k = 0; k < N_; k++)
+    distances[k] = direction.x() * (control_points_(k, 1) - p1.y()) - direction.y() * (control_points_(k, 0) - p1.x());
+  uint count = N_ <= 4 ? Bernstein::rootsClosedForm(distances, N_, roots)
+                       : Bernstein::roots(distances, N_, roots, epsilon);
+  std::sort(roots, roots + count);
+
+  std::vector<Intersection> intersections;
+  for (uint k = 0; k < count; k++)
+  {
+    const Point point = valueAt(roots[k]);
+    const double t = (point - p1).dot(direction) / length;
+    if ((type != LineType::Line && t < 0) || (type == LineType::Segment && t > 1))
+      continue;
+    intersections.push_back(Intersection{roots[k], t, point});
+  }
+  return intersections;
+}
+
+std::vector<Intersection> Curve::subdivideIntersections(const Curve& curve, bool stop_at_first, double epsilon) const
+{
+  std::vector<Intersection> intersections;
+  // stack grows by at most 3 pairs with each halving of both subcurves
+  auto diagonal = [](const Eigen::MatrixX2d& points)
+  {
+    return (points.colwise().maxCoeff() - points.colwise().minCoeff()).norm();
+  };
+  const double size = std::max(diagonal(control_points_), diagonal(curve.control_points_));
+  const std::size_t depth = size > epsilon ? static_cast<std::size_t>(std::log2(size / epsilon)) + 2 : 1;
+  SubcurvePairs pairs(N_, curve.N_, 3 * depth + 1);
+  double* pair = pairs.push();
+  pairs.set(pair, 0, control_points_.col(0).data(), control_points_.col(1).data(), 0, 1);
+  pairs.set(pair, 1, curve.control_points_.col(0).data(), curve.control_points_.col(1).data(), 0, 1);
+
+  // current pair and halves of its subcurves, kept while new pairs are pushed
+  std::vector<double> scratch(pairs.stride() + 4 * (N_ + curve.N_));
+  double* current = scratch.data();
+  double* halves[2] = {current + pairs.stride(), current + pairs.stride() + 4 * N_};
 
-    BBox bbox1 = part_a->getBBox(false); // very slow with tight BBox (roots)
-    BBox bbox2 = part_b->getBBox(false); // very slow with tight BBox (roots)
+  while (!pairs.empty())
+  {
+    pair = pairs.top();
+    BBox bbox1 = pairs.bbox(pair, 0);
+    BBox bbox2 = pairs.bbox(pair, 1);
     if (!bbox1.intersects(bbox2))
     {
       // no intersection
+      pairs.pop();
       continue;
     }
 
-    if (bbox1.diagonal().norm() < epsilon && bbox2.diagonal().norm() < epsilon)
+    const bool small[2] = {bbox1.diagonal().norm() < epsilon, bbox2.diagonal().norm() < epsilon};
+    if (small[0] && small[1])
     {
       // segments converged, check if not already found and add new
-      Point new_point = part_a->valueAt(0.5);
-      if (points_of_intersection.end() == std::find_if(points_of_intersection.begin(), points_of_intersection.end(),
-                                                       [new_point, epsilon](const Point& point)
-                                                       {
-                                                         return (point - new_point).norm() < epsilon;
-                                                       }))
-      {
-        points_of_intersection.push_back(new_point);
-
-        // if only first point is needed, stop
-        if (stop_at_first)
-          return points_of_intersection;
-      }
+      const double t1 = pairs.middle(pair, 0), t2 = pairs.middle(pair, 1);
+      pairs.pop();
+      if (addIntersection(intersections, Intersection{t1, t2, valueAt(t1)}, epsilon) && stop_at_first)
+        break;
       continue;
     }
 
     // intersection exists, but segments are still too large
     // divide both segments in half and new pairs
+    std::copy(pair, pair + pairs.stride(), current);
+    pairs.pop();
+    for (uint part = 0; part < 2; part++)
+      if (!small[part])
+        pairs.halve(current, part, halves[part]);
+
     // LIFO : we want to first discover closest intersection (smallest t on this curve)
-    // so it is important which pair of subcurves is inserted first
-    std::vector<std::shared_ptr<const Curve>> subcurves_a;
-    std::vector<std::shared_ptr<const Curve>> subcurves_b;
+    // so 2nd halves t = [0.5 to 1] are inserted first, last pair is one with smallest t ranges
+    for (uint half_b = small[1] ? 1 : 0; half_b < 2; half_b++)
+      for (uint half_a = small[0] ? 1 : 0; half_a < 2; half_a++)
+      {
+        pair = pairs.push();
+        const uint half[2] = {half_a, half_b};
+        for (uint part = 0; part < 2; part++)
+        {
+          const uint n = pairs.count(part);
+          const double* range = pairs.range(current, part);
+          if (small[part])
+            pairs.set(pair, part, pairs.x(current, part), pairs.y(current, part), range[0], range[1]);
+          else if (half[part] == 0)
+            pairs.set(pair, part, halves[part] + 2 * n, halves[part] + 3 * n, (range[0] + range[1]) / 2, range[1]);
+          else
+            pairs.set(pair, part, halves[part], halves[part] + n, range[0], (range[0] + range[1]) / 2);
+        }
+      }
+  }
+  return intersections;
+}
+
+std::vector<Intersection> Curve::clipIntersections(const Curve& curve, bool stop_at_first, double epsilon) const
+{
+  // clipping has to remove at least this part of parameter range, otherwise subcurves are halved
+  const double min_reduction = 0.2;
+  // bound on work, in case clipping stalls without curves being found to overlap
+  const std::size_t max_iterations = 10000;
+
+  std::vector<Intersection> intersections;
+  SubcurvePairs pairs(N_, curve.N_, 16);
+  double* pair = pairs.push();
+  pairs.set(pair, 0, control_points_.col(0).data(), control_points_.col(1).data(), 0, 1);
+  pairs.set(pair, 1, curve.control_points_.col(0).data(), curve.control_points_.col(1).data(), 0, 1);
+
+  // fat line of a straight part has zero width, so it is widened to cover rounding errors of distances
+  const double margin =
+      1e-12 * std::max(control_points_.cwiseAbs().maxCoeff(), curve.control_points_.cwiseAbs().maxCoeff());
+
+  // current pair, halves of its subcurve, distances from fat line and scratch for de Casteljau
+  const uint n_max = std::max(N_, curve.N_);
+  std::vector<double> scratch(pairs.stride() + 6 * n_max);
+  double* current = scratch.data();
+  double* halves = current + pairs.stride();
+  double* distances = halves + 4 * n_max;
+  double* work = distances + n_max;
+
+  // width of fat line each part was last clipped with
+  double fat_width[2];
+  // curves are checked for overlap once clipping stalls on nearly straight parts
+  bool overlap_checked = false, overlapping = false;
+  Intersection overlap[2];
+  auto inside_overlap = [&](double* pair)
+  {
+    const double *range_a = pairs.range(pair, 0), *range_b = pairs.range(pair, 1);
+    const double b_min = std::min(overlap[0].t2, overlap[1].t2), b_max = std::max(overlap[0].t2, overlap[1].t2);
+    return range_a[0] >= overlap[0].t1 && range_a[1] <= overlap[1].t1 && range_b[0] >= b_min && range_b[1] <= b_max;
+  };
 
-    if (bbox1.diagonal().norm() < epsilon)
+  // clip part to range where it can lie within fat line of other part, false if there is no such range
+  auto clip = [&](double* pair, uint part)
+  {
+    const uint n = pairs.count(part), m = pairs.count(1 - part);
+    const double *other_x = pairs.x(pair, 1 - part), *other_y = pairs.y(pair, 1 - part);
+    Vec2 direction(other_x[m - 1] - other_x[0], other_y[m - 1] - other_y[0]);
+    for (uint k = 1; k < m && direction.isZero(); k++)
+      direction = Vec2(other_x[k] - other_x[0], other_y[k] - other_y[0]); // closed subcurve, any line will do
+    if (direction.isZero())
+      direction = Vec2(1, 0);
+    const Vec2 normal = Vec2(-direction.y(), direction.x()).normalized();
+
+    double lower = 0, upper = 0;
+    for (uint k = 0; k < m; k++)
     {
-      // if small enough, do not divide it further
-      subcurves_a.push_back(part_a);
+      double distance = normal.x() * (other_x[k] - other_x[0]) + normal.y() * (other_y[k] - other_y[0]);
+      lower = std::min(lower, distance - margin);
+      upper = std::max(upper, distance + margin);
     }
-    else
+    fat_width[part] = upper - lower;
+    double *part_x = pairs.x(pair, part), *part_y = pairs.y(pair, part);
+    for (uint k = 0; k < n; k++)
+      distances[k] = normal.x() * (part_x[k] - other_x[0]) + normal.y() * (part_y[k] - other_y[0]);
+    double t_min, t_max;
+    if (!Bernstein::clip(distances, n, lower, upper, t_min, t_max))
+      return false;
+
+    if (t_min > 0 || t_max < 1)
     {
-      // divide into two subcurves
-      // first insert 2nd subcurve t = [0.5 to 1]
-      subcurves_a.push_back(std::make_shared<Curve>(part_a->splittingCoeffsRight() * part_a->control_points_));
-      subcurves_a.push_back(std::make_shared<Curve>(part_a->splittingCoeffsLeft() * part_a->control_points_));
+      Bernstein::interval(part_x, n, t_min, t_max, part_x, work);
+      Bernstein::interval(part_y, n, t_min, t_max, part_y, work);
+      double* range = pairs.range(pair, part);
+      const double width = range[1] - range[0];
+      range[1] = range[0] + t_max * width;
+      range[0] += t_min * width;
+      pairs.updateBBox(pair, part);
     }
+    return true;
+  };
 
-    if (bbox2.diagonal().norm() < epsilon)
+  // LIFO: pairs with smaller t on this curve are processed first
+  for (std::size_t iteration = 0; !pairs.empty() && iteration < max_iterations; iteration++)
+  {
+    pair = pairs.top();
+    if (overlapping && inside_overlap(pair))
     {
-      // if small enough, do not divide it further
-      // first insert 2nd subcurve t = [0.5 to 1]
-      subcurves_b.push_back(part_b);
+      // only ends of common part are reported
+      pairs.pop();
+      continue;
     }
-    else
+
+    BBox bbox_a = pairs.bbox(pair, 0), bbox_b = pairs.bbox(pair, 1);
+    // clipping converges to degenerate boxes, which rounding errors can keep slightly apart
+    const bool converged = bbox_a.diagonal().norm() < epsilon && bbox_b.diagonal().norm() < epsilon;
+    if (converged ? bbox_a.exteriorDistance(bbox_b) >= epsilon : !bbox_a.intersects(bbox_b))
+    {
+      pairs.pop();
+      continue;
+    }
+
+    if (converged)
+    {
+      // parts converged, check if not already found and add new
+      const double t1 = pairs.middle(pair, 0), t2 = pairs.middle(pair, 1);
+      pairs.pop();
+      if (addIntersection(intersections, Intersection{t1, t2, valueAt(t1)}, epsilon) && stop_at_first)
+        break;
+      continue;
+    }
+
+    const double width_a = pairs.range(pair, 0)[1] - pairs.range(pair, 0)[0];
+    const double width_b = pairs.range(pair, 1)[1] - pairs.range(pair, 1)[0];
+    if (!clip(pair, 0) || !clip(pair, 1))
+    {
+      pairs.pop();
+      continue;
+    }
+
+    if (pairs.range(pair, 0)[1] - pairs.range(pair, 0)[0] > (1 - min_reduction) * width_a &&
+        pairs.range(pair, 1)[1] - pairs.range(pair, 1)[0] > (1 - min_reduction) * width_b)
     {
-      // divide into two subcurves
-      subcurves_b.push_back(std::make_shared<Curve>(part_b->splittingCoeffsRight() * part_b->control_points_));
-      subcurves_b.push_back(std::make_shared<Curve>(part_b->splittingCoeffsLeft() * part_b->control_points_));
+      // nearly straight parts, each within fat line of the other one, are collinear
+      if (!overlap_checked && fat_width[0] < epsilon && fat_width[1] < epsilon)
+      {
+        overlap_checked = true;
+        overlapping = findOverlap(curve, epsilon, overlap);
+        if (overlapping)
+        {
+          addIntersection(intersections, overlap[0], epsilon);
+          if (stop_at_first)
+            break;
+          addIntersection(intersections, overlap[1], epsilon);
+        }
+      }
+
+      // halve the larger part, first insert 2nd half
+      const uint part = pairs.bbox(pair, 0).diagonal().norm() >= pairs.bbox(pair, 1).diagonal().norm() ? 0 : 1;
+      const uint n = pairs.count(part);
+      std::copy(pair, pair + pairs.stride(), current);
+      pairs.pop();
+      pairs.halve(current, part, halves);
+      const double* range = pairs.range(current, part);
+      const double middle = (range[0] + range[1]) / 2;
+
+      pair = pairs.push();
+      std::copy(current, current + pairs.stride(), pair);
+      pairs.set(pair, part, halves + 2 * n, halves + 3 * n, middle, range[1]);
+      pair = pairs.push();
+      std::copy(current, current + pairs.stride(), pair);
+      pairs.set(pair, part, halves, halves + n, range[0], middle);
     }
+  }
+  return intersections;
+}
 
-    // insert all combinations for next iteration
-    // last pair is one where both subcurves have smalles t ranges
-    for (auto&& subcurve_b : subcurves_b)
-      for (auto&& subcurve_a : subcurves_a)
-        subcurve_pairs.push_back(std::make_pair(subcurve_a, subcurve_b));
+bool Curve::findOverlap(const Curve& curve, double epsilon, Intersection ends[2]) const
+{
+  std::vector<Intersection> candidates;
+  for (double t : {0., 1.})
+  {
+    const Point point = valueAt(t);
+    const double t2 = curve.projectPointOnCurve(point);
+    if ((curve.valueAt(t2) - point).norm() < epsilon)
+      candidates.push_back(Intersection{t, t2, point});
+
+    const Point other_point = curve.valueAt(t);
+    const double t1 = projectPointOnCurve(other_point);
+    if ((valueAt(t1) - other_point).norm() < epsilon)
+      candidates.push_back(Intersection{t1, t, other_point});
   }
-  return points_of_intersection;
+  if (candidates.size() < 2)
+    return false;
+
+  auto ordered = std::minmax_element(candidates.begin(), candidates.end(),
+                                     [](const Intersection& lhs, const Intersection& rhs) { return lhs.t1 < rhs.t1; });
+  ends[0] = *ordered.first;
+  ends[1] = *ordered.second;
+  if ((ends[1].point - ends[0].point).norm() < epsilon)
+    return false;
+
+  // parametrizations of common part differ only by scale and offset
+  const uint samples = N_ + curve.N_ + 2;
+  for (uint k = 1; k < samples; k++)
+  {
+    const double u = static_cast<double>(k) / samples;
+    const double t1 = ends[0].t1 + u * (ends[1].t1 - ends[0].t1), t2 = ends[0].t2 + u * (ends[1].t2 - ends[0].t2);
+    if ((valueAt(t1) - curve.valueAt(t2)).norm() >= epsilon)
+      return false;
+  }
+  return true;
 }
 
-double Curve::projectPointOnCurve(const Point& point, double step) const
+double Curve::projectNewton(const ProjectionTable& table, const Point& point, double epsilon, double& distance) const
 {
-  double t = 0;
-  double t_dist = (valueAt(t) - point).norm();
+  const uint count = static_cast<uint>(table.samples.rows());
+  const double step = 1. / (count - 1);
+  uint closest;
+  ((table.samples.col(0).array() - point.x()).square() + (table.samples.col(1).array() - point.y()).square())
+      .minCoeff(&closest);
 
-  // Coarse search
-  for (double k = step; k < 1 + step; k += step)
+  // minimize |B(t) - P|^2 with Newton iterations on its derivative 2 (B(t) - P) . B'(t)
+  const double lower = closest > 0 ? (closest - 1) * step : 0;
+  const double upper = closest + 1 < count ? (closest + 1) * step : 1;
+  const double* x = control_points_.col(0).data();
+  const double* y = control_points_.col(1).data();
+  double t = closest * step;
+  for (uint iteration = 0; iteration < 16; iteration++)
   {
-    double new_dist = (valueAt(k) - point).norm();
+    const Vec2 difference(Bernstein::horner(x, N_, t) - point.x(), Bernstein::horner(y, N_, t) - point.y());
+    const Vec2 derivative(Bernstein::horner(table.derivative.col(0).data(), N_ - 1, t),
+                          Bernstein::horner(table.derivative.col(1).data(), N_ - 1, t));
+    Vec2 second_derivative(0, 0);
+    if (N_ > 2)
+      second_derivative = Vec2(Bernstein::horner(table.second_derivative.col(0).data(), N_ - 2, t),
+                               Bernstein::horner(table.second_derivative.col(1).data(), N_ - 2, t));
+
+    // stop where distance isn't convex, Newton step wouldn't head for minimum
+    const double slope = derivative.squaredNorm() + difference.dot(second_derivative);
+    if (slope <= 0)
+      break;
+    const double new_t = std::max(lower, std::min(upper, t - difference.dot(derivative) / slope));
+    const bool converged = fabs(new_t - t) < epsilon;
+    t = new_t;
+    if (converged)
+      break;
+  }
+
+  // keep the sample if iterations made it worse
+  const double sample_distance = (Vec2(table.samples.row(closest)) - point).norm();
+  distance = (valueAt(t) - point).norm();
+  if (distance > sample_distance)
+  {
+    distance = sample_distance;
+    return closest * step;
+  }
+  return t;
+}
+
+std::shared_ptr<const Curve::ProjectionPolynomial> Curve::projectionPolynomial() const
+{
+  auto cache = getCache();
+  std::shared_ptr<ProjectionPolynomial> polynomial;
+  if (cache)
+    polynomial = std::atomic_load(&cache->projection_polynomial);
+  if (polynomial)
+    return polynomial;
+
+  // (B(t) - P) . B'(t) = B(t) . B'(t) - P . B'(t), scaling of derivative is irrelevant for roots
+  polynomial = std::make_shared<ProjectionPolynomial>();
+  Eigen::MatrixX2d derivative = control_points_.bottomRows(N_ - 1) - control_points_.topRows(N_ - 1);
+  Eigen::VectorXd product(2 * N_ - 2), ones(Eigen::VectorXd::Ones(N_));
+  polynomial->dot.resize(2 * N_ - 2);
+  polynomial->derivative.resize(2 * N_ - 2, 2);
+  Bernstein::product(control_points_.col(0).data(), N_, derivative.col(0).data(), N_ - 1, polynomial->dot.data());
+  Bernstein::product(control_points_.col(1).data(), N_, derivative.col(1).data(), N_ - 1, product.data());
+  polynomial->dot += product;
+  for (long k = 0; k < 2; k++)
+    Bernstein::product(ones.data(), N_, derivative.col(k).data(), N_ - 1, polynomial->derivative.col(k).data());
+
+  if (cache)
+    std::atomic_store(&cache->projection_polynomial, polynomial);
+  return polynomial;
+}
+
+double Curve::projectExact(const ProjectionPolynomial& polynomial, const Point& point, double epsilon, double* scratch,
+                           Bernstein::RootsWorkspace& workspace) const
+{
+  // closest point is at the end or where (B(t) - P) . B'(t) = 0, which is polynomial of degree 2N - 3
+  const uint n = 2 * N_ - 2;
+  double* coeffs = scratch;
+  double* candidates = scratch + n;
+  for (uint k = 0; k < n; k++)
+    coeffs[k] = polynomial.dot(k) - point.x() * polynomial.derivative(k, 0) - point.y() * polynomial.derivative(k, 1);
+
+  uint count = Bernstein::roots(coeffs, n, candidates, workspace, epsilon);
+  candidates[count++] = 1;
+
+  double t = 0;
+  double t_dist = (valueAt(t) - point).squaredNorm();
+  for (uint k = 0; k < count; k++)
+  {
+    double new_dist = (valueAt(candidates[k]) - point).squaredNorm();
     if (new_dist < t_dist)
     {
       t_dist = new_dist;
-      t = k;
+      t = candidates[k];
     }
   }
+  return t;
+}
 
-  // fine search
-  do
-  {
-    double new_dist1 = (valueAt(t - step / 2) - point).norm();
-    double new_dist2 = (valueAt(t + step / 2) - point).norm();
+double Curve::projectPointOnCurve(const Point& point, ProjectionMethod method, double epsilon) const
+{
+  if (N_ < 2)
+    return 0;
 
-    if (new_dist1 > t_dist && new_dist2 > t_dist)
-    {
-      step /= 2;
-      continue;
-    }
-    if ((new_dist1 < new_dist2 ? new_dist1 : new_dist2) < t_dist)
-    {
-      t_dist = (new_dist1 < new_dist2 ? new_dist1 : new_dist2);
-      t += new_dist1 < new_dist2 ? -step / 2 : step / 2;
-    }
-  } while (step > 0.0001);
+  if (method == ProjectionMethod::Newton)
+  {
+    double distance;
+    return projectNewton(*projectionTable(), point, epsilon, distance);
+  }
 
-  // if closest point is between <1, 1+step>
-  if (t > 1)
-    t = 1;
-  // if closest point is between < -step, 0>
-  if (t < 0)
-    t = 0;
+  std::vector<double> scratch(4 * N_ - 3);
+  Bernstein::RootsWorkspace workspace;
+  return projectExact(*projectionPolynomial(), point, epsilon, scratch.data(), workspace);
+}
 
-  return t;
+double Curve::projectPointOnCurve(const Point& point, double) const
+{
+  return projectPointOnCurve(point, ProjectionMethod::Exact);
 }
+
+void Curve::projectPointsOnCurve(const double* x, const double* y, std::size_t count, double* t, double* distance,
+                                 ProjectionMethod method, double epsilon, unsigned threads) const
+{
+  // shared by all threads, so data depending only on curve is prepared once
+  std::shared_ptr<const ProjectionTable> table;
+  std::shared_ptr<const ProjectionPolynomial> polynomial;
+  if (N_ > 1)
+  {
+    if (method == ProjectionMethod::Newton)
+      table = projectionTable();
+    else
+      polynomial = projectionPolynomial();
+  }
+
+  Parallel::forEach(count, threads, 256, [&](std::size_t begin, std::size_t end)
+                    {
+                      std::vector<double> scratch(polynomial ? 4 * N_ - 3 : 0);
+                      Bernstein::RootsWorkspace workspace;
+                      for (std::size_t k = begin; k < end; k++)
+                      {
+                        const Point point(x[k], y[k]);
+                        double point_distance;
+                        if (table)
+                        {
+                          t[k] = projectNewton(*table, point, epsilon, point_distance);
+                        }
+                        else
+                        {
+                          t[k] = polynomial ? projectExact(*polynomial, point, epsilon, scratch.data(), workspace) : 0;
+                          point_distance = (valueAt(t[k]) - point).norm();
+                        }
+                        if (distance)
+                          distance[k] = point_distance;
+                      }
+                    });
 }
+}
\ No newline at end of file
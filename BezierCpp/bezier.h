@@ -21,6 +21,20 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "bernstein.h"
+#include "flattening.h"
+
+/// Marks functions kept only for source compatibility
+#if __cplusplus >= 201402L
+#define BEZIER_DEPRECATED(message) [[deprecated(message)]]
+#elif defined(__GNUC__)
+#define BEZIER_DEPRECATED(message) __attribute__((deprecated(message)))
+#else
+#define BEZIER_DEPRECATED(message)
+#endif
 
 /*!
  * Nominal namespace containing class definition and typedefs
@@ -44,13 +58,67 @@ typedef std::vector<Point> PointVector;
  */
 typedef Eigen::AlignedBox2d BBox;
 
+/*!
+ * \brief Algorithm used for evaluating points on curve
+ */
+enum class EvaluationMethod : unsigned char
+{
+  PowerBasis,  /*!< Multiplication with power basis coefficients (reference implementation, allocates) */
+  DeCasteljau, /*!< Repeated linear interpolation, numerically most stable */
+  Horner       /*!< Horner scheme in Bernstein basis, fastest */
+};
+
+/*!
+ * \brief Algorithm used for projecting a point onto curve
+ */
+enum class ProjectionMethod : unsigned char
+{
+  Exact, /*!< Global minimum among roots of polynomial (B(t) - P) . B'(t) and end points */
+  Newton /*!< Newton iterations from the closest of cached samples, much faster but may end in local minimum */
+};
+
+/*!
+ * \brief Extent of straight line given by two points p1 and p2
+ */
+enum class LineType : unsigned char
+{
+  Line,   /*!< Infinite line through both points */
+  Ray,    /*!< Half-line starting at p1 and passing through p2 */
+  Segment /*!< Segment between p1 and p2 */
+};
+
+/*!
+ * \brief Algorithm used for finding points of intersection of two curves
+ */
+enum class IntersectionMethod : unsigned char
+{
+  Subdivision,   /*!< Halving both curves while their bounding boxes intersect, converges linearly */
+  BezierClipping /*!< Clipping each curve with fat line of the other one, converges quadratically */
+};
+
+/*!
+ * \brief Point of intersection of two curves
+ */
+struct Intersection
+{
+  double t1;   /*! Parameter t on the first curve */
+  double t2;   /*! Parameter t on the second curve */
+  Point point; /*! Point of intersection */
+};
+
 /*!
  * \brief A Bezier curve class
  *
  * A class for storing and using any-order Bezier curve.
  * It uses private and static caching for storing often accessed data.
  * Private caching is used for data concerning individual curve, while
- * static caching is used for common data (coefficient matrices)
+ * static caching is used for common data (coefficient matrices).
+ * All caches are thread-safe: const methods of the same curve can be
+ * called from multiple threads without external locking.
+ *
+ * Private cache is a single block, allocated on first use and shared between
+ * copies of a curve. Curves that are rarely queried (e.g. when holding large
+ * collections) can disable caching, in which case they hold only control points.
  */
 class Curve : public std::enable_shared_from_this<Curve>
 {
@@ -64,41 +132,241 @@ private:
    */
   typedef std::map<uint, Coeffs> CoeffsMap;
 
+  /*!
+   * \brief Thread-safe storage of coefficient matrices, indexed by number of control points
+   *
+   * Matrices up to BEZIER_PRECOMPUTED_ORDER are created together with the storage,
+   * during static initialization, and never change afterwards, so reading them
+   * requires no synchronization.
+   * Matrices for higher orders are created on demand under a lock.
+   */
+  class CoeffsCache
+  {
+  public:
+    /// Function creating coefficient matrix for given number of control points
+    typedef Coeffs (*Generator)(uint);
+
+    /*!
+     * \brief Create storage and precompute matrices
+     * \param generator Function creating coefficient matrices
+     * \param first Smallest number of control points for which matrix exists
+     */
+    CoeffsCache(Generator generator, uint first);
+
+    /*!
+     * \brief Get the coefficient matrix
+     * \param n Number of control points
+     * \return Reference to matrix, valid for the lifetime of the program
+     */
+    const Coeffs& at(uint n) const;
+
+  private:
+    Generator generator_;             /*! Function creating coefficient matrices */
+    uint first_;                      /*! Number of control points of first precomputed matrix */
+    std::vector<Coeffs> precomputed_; /*! Immutable matrices up to BEZIER_PRECOMPUTED_ORDER */
+    mutable CoeffsMap computed_;      /*! Matrices of higher orders, created on demand */
+    mutable std::mutex mutex_;        /*! Guards computed_ */
+  };
+
   /// Number of control points (order + 1)
   uint N_;
+  /// Algorithm used by valueAt when none is specified
+  EvaluationMethod evaluation_method_ = EvaluationMethod::Horner;
+  /// If data concerning this curve should be cached
+  bool caching_ = true;
   /// N x 2 matrix where each row corresponds to control Point
   Eigen::MatrixX2d control_points_;
 
+  /*!
+   * \brief Polyline together with parameters used to create it
+   */
+  struct Polyline
+  {
+    double smoothness;  /*! Smoothness factor used for generating polyline (0 if generated with tolerance) */
+    double precision;   /*! Precision used for generating polyline (0 if generated with tolerance) */
+    double tolerance;   /*! Maximal distance from curve (0 if generated with smoothness and precision) */
+    PointVector points; /*! Polyline vertices */
+  };
+
+  /// Cached polylines for different parameters, most recently generated first
+  typedef std::vector<std::shared_ptr<const Polyline>> PolylineLevels;
+
+  /// Maximal number of polylines cached for each curve
+  static const std::size_t max_cached_polylines = 4;
+
+  /// Default precision of t of extremes, only extremes found with it are cached
+  static constexpr double extremes_epsilon = 1e-10;
+  /// Default budget of root finding steps for extremes, only extremes found with it are cached
+  static const std::size_t extremes_max_iter = 1000;
+
+  /*!
+   * \brief Data for projecting points with Newton iterations
+   */
+  struct ProjectionTable
+  {
+    Eigen::MatrixX2d samples;           /*! Points on curve at uniformly spaced t, first and last included */
+    Eigen::MatrixX2d derivative;        /*! Control points of derivative */
+    Eigen::MatrixX2d second_derivative; /*! Control points of second derivative (empty for lines) */
+  };
+
+  /*!
+   * \brief Bernstein coefficients of (B(t) - P) . B'(t), which are affine in P
+   *
+   * Coefficients for point P are dot - P.x derivative.col(0) - P.y derivative.col(1).
+   */
+  struct ProjectionPolynomial
+  {
+    Eigen::VectorXd dot;         /*! Coefficients of B(t) . B'(t) */
+    Eigen::MatrixX2d derivative; /*! Coefficients of B'(t), elevated to the same degree */
+  };
+
+  /*!
+   * \brief Data concerning individual curve, stored for later use
+   *
+   * Created on first use and shared between copies of a curve. Each member is
+   * generated at most once and never modified afterwards; pointers are read and
+   * published with atomic operations, so const methods may run concurrently.
+   */
+  struct Cache
+  {
+    std::shared_ptr<Curve> derivative;              /*! If generated, stores derivative for later use */
+    std::shared_ptr<std::vector<Point>> ext_points; /*! If generated, stores extreme Points for later use */
+    std::shared_ptr<BBox> bounding_box_tight;   /*! If generated, stores bounding box (use_roots = true) for later use */
+    std::shared_ptr<BBox> bounding_box_relaxed; /*! If generated, stores bounding box (use_roots = false) for later use */
+    std::shared_ptr<PolylineLevels> polylines;  /*! If generated, stores polylines for later use */
+    std::shared_ptr<ProjectionTable> projection; /*! If generated, stores samples for projecting points */
+    std::shared_ptr<ProjectionPolynomial> projection_polynomial; /*! If generated, stores polynomial for projecting */
+  };
+
   // private caching
-  std::shared_ptr<Curve> cached_derivative_;              /*! If generated, stores derivative for later use */
-  std::shared_ptr<std::vector<Point>> cached_ext_points_; /*! If generated, stores extreme Points for later use */
-  std::shared_ptr<BBox>
-      cached_bounding_box_tight_; /*! If generated, stores bounding box (use_roots = true) for later use */
-  std::shared_ptr<BBox>
-      cached_bounding_box_relaxed_; /*! If generated, stores bounding box (use_roots = false) for later use */
-  std::shared_ptr<PointVector> cached_polyline_; /*! If generated, stores polyline for later use */
-  double cached_polyline_smootheness_ = 0;       /*! Smootheness of cached polyline */
+  mutable std::shared_ptr<Cache> cache_; /*! If generated, stores cached data of this curve */
+
+  /// Get the cache of this curve, creating it if needed (nullptr if caching is disabled)
+  std::shared_ptr<Cache> getCache() const;
+
+  /*!
+   * \brief Get cached data, generating and caching it if needed
+   * \param member Member of Cache holding the data
+   * \param generate Function generating the data
+   * \return Cached or newly generated data
+   */
+  template <typename T, typename Generator> T cached(std::shared_ptr<T> Cache::*member, Generator generate) const;
+
+  /*!
+   * \brief Get polyline from cache, generating and caching it if needed
+   * \param smoothness Smoothness factor (0 when using tolerance)
+   * \param precision Minimal distance between two subsequent points (0 when using tolerance)
+   * \param tolerance Maximal distance between curve and polyline (0 when using smoothness)
+   * \return A vector of polyline vertices
+   */
+  PointVector cachedPolyline(double smoothness, double precision, double tolerance) const;
+
+  /*!
+   * \brief Find polyline in cache
+   * \param smoothness Smoothness factor (0 when using tolerance)
+   * \param precision Minimal distance between two subsequent points (0 when using tolerance)
+   * \param tolerance Maximal distance between curve and polyline (0 when using smoothness)
+   * \return Cached polyline or nullptr if it is not cached
+   */
+  std::shared_ptr<const Polyline> findPolyline(double smoothness, double precision, double tolerance) const;
+
+  /*!
+   * \brief Get the table for projecting points from cache, generating and caching it if needed
+   * \return Table with samples and derivatives of curve
+   *
+   * Unlike cached, table is not copied, so projecting a point allocates no memory
+   */
+  std::shared_ptr<const ProjectionTable> projectionTable() const;
+
+  /*!
+   * \brief Project point on curve with Newton iterations from the closest sample
+   * \param table Table of samples and derivatives of this curve
+   * \param point Point to project on curve
+   * \param epsilon Precision of resulting t
+   * \param distance Receives the distance from point to curve at resulting t
+   * \return Parameter t
+   */
+  double projectNewton(const ProjectionTable& table, const Point& point, double epsilon, double& distance) const;
+
+  /*!
+   * \brief Get the projection polynomial from cache, generating and caching it if needed
+   * \return Coefficients of polynomial whose roots are candidates for closest points
+   */
+  std::shared_ptr<const ProjectionPolynomial> projectionPolynomial() const;
+
+  /*!
+   * \brief Project point on curve exactly, among roots of (B(t) - P) . B'(t) and end points
+   * \param polynomial Coefficients of projection polynomial of this curve
+   * \param point Point to project on curve
+   * \param epsilon Precision of resulting t
+   * \param scratch Buffer for 4 N - 3 values, N being number of control points
+   * \param workspace Working memory of root finding
+   * \return Parameter t
+   */
+  double projectExact(const ProjectionPolynomial& polynomial, const Point& point, double epsilon, double* scratch,
+                      Bernstein::RootsWorkspace& workspace) const;
+
+  /*!
+   * \brief Get parameters of extremes on both axes
+   * \param epsilon Precision of resulting t
+   * \param max_iter Budget of subdivision and refinement steps per axis
+   * \return Parameters t of extremes, first for x and then for y axis
+   */
+  std::vector<double> extremeParameters(double epsilon = extremes_epsilon,
+                                        std::size_t max_iter = extremes_max_iter) const;
+
+  /*!
+   * \brief Find intersections with bounding box subdivision
+   * \param curve Curve to intersect with
+   * \param stop_at_first If first intersection is enough
+   * \param epsilon Precision of resulting intersection
+   * \return A vector of intersections
+   */
+  std::vector<Intersection> subdivideIntersections(const Curve& curve, bool stop_at_first, double epsilon) const;
+
+  /*!
+   * \brief Find intersections with Bezier clipping
+   * \param curve Curve to intersect with
+   * \param stop_at_first If first intersection is enough
+   * \param epsilon Precision of resulting intersection
+   * \return A vector of intersections
+   */
+  std::vector<Intersection> clipIntersections(const Curve& curve, bool stop_at_first, double epsilon) const;
+
+  /*!
+   * \brief Find common part of two curves
+   * \param curve Curve to compare with
+   * \param epsilon Allowed distance between curves
+   * \param ends Receives both ends of common part, ordered by t1
+   * \return If curves overlap
+   *
+   * Common part of polynomial curves can end only where one of them ends, so end points of
+   * both curves are projected on the other one, and curves are compared between found ends.
+   */
+  bool findOverlap(const Curve& curve, double epsilon, Intersection ends[2]) const;
 
   /// Reset all privately cached data
   inline void resetCache();
 
   // static caching
-  static CoeffsMap bernstein_coeffs_;       /*! Map of Bernstein coefficients */
-  static CoeffsMap splitting_coeffs_left_;  /*! Map of coefficients to get subcurve for t = [0, 0.5] */
-  static CoeffsMap splitting_coeffs_right_; /*! Map of coefficients to get subcurve for t = [0.5, 1] */
-  static CoeffsMap elevate_order_coeffs_;   /*! Map of coefficients for elevating the order of curve */
-  static CoeffsMap lower_order_coeffs_;     /*! Map of coefficients for lowering the order of curve */
+  static const CoeffsCache& bernsteinCache();    /*! Cache of Bernstein coefficients */
+  static const CoeffsCache& elevateOrderCache(); /*! Cache of coefficients for elevating the order of curve */
+  static const CoeffsCache& lowerOrderCache();   /*! Cache of coefficients for lowering the order of curve */
+  static const bool static_cache_ready_;         /*! Forces creation of all caches at static initialization */
+
+  /// Create Bernstein coefficients for n control points
+  static Coeffs createBernsteinCoeffs(uint n);
+  /// Create coefficients to elevate order of curve with n control points
+  static Coeffs createElevateOrderCoeffs(uint n);
+  /// Create coefficients to lower order of curve with n control points
+  static Coeffs createLowerOrderCoeffs(uint n);
 
   /// Private getter function for Bernstein coefficients
-  Coeffs bernsteinCoeffs() const;
-  /// Private getter function for coefficients to get a subcurve t = [0, z];
-  Coeffs splittingCoeffsLeft(double z = 0.5) const;
-  /// Private getter function for coefficients to get a subcurve t = [z, 1];
-  Coeffs splittingCoeffsRight(double z = 0.5) const;
+  const Coeffs& bernsteinCoeffs() const;
   /// Private getter function for coefficients to elevate order of curve
-  Coeffs elevateOrderCoeffs(uint n) const;
+  const Coeffs& elevateOrderCoeffs(uint n) const;
   /// Private getter function for coefficients to lower order of curve
-  Coeffs lowerOrderCoeffs(uint n) const;
+  const Coeffs& lowerOrderCoeffs(uint n) const;
 
 public:
   /*!
@@ -113,6 +381,50 @@ public:
    */
   Curve(const PointVector& points);
 
+  /*!
+   * \brief Create a copy of the Bezier curve
+   * \param curve Curve to copy, along with its cached data
+   *
+   * Safe while other threads call const methods of the original curve
+   */
+  Curve(const Curve& curve);
+
+  /*!
+   * \brief Move the Bezier curve
+   * \param curve Curve to move
+   */
+  Curve(Curve&& curve) = default;
+
+  /*!
+   * \brief Copy the Bezier curve
+   * \param curve Curve to copy, along with its cached data
+   * \return Reference to this curve
+   *
+   * Safe while other threads call const methods of the original curve
+   */
+  Curve& operator=(const Curve& curve);
+
+  /*!
+   * \brief Move the Bezier curve
+   * \param curve Curve to move
+   * \return Reference to this curve
+   */
+  Curve& operator=(Curve&& curve) = default;
+
+  /*!
+   * \brief Enable or disable caching of data concerning this curve
+   * \param enabled If derivative, extremes, bounding boxes and polyline should be cached
+   *
+   * Disabling the cache releases any cached data
+   */
+  void setCachingEnabled(bool enabled);
+
+  /*!
+   * \brief Check if data concerning this curve is cached
+   * \return True if caching is enabled
+   */
+  bool isCachingEnabled() const;
+
   /*!
    * \brief Get the control points
    * \return A vector of control points
@@ -127,6 +439,87 @@ public:
    */
   PointVector getPolyline(double smoothness = 1.0001, double precision = 1.0) const;
 
+  /*!
+   * \brief Write a polyline representation of curve to an output iterator
+   * \param out Output iterator receiving polyline vertices (e.g. pointer to a preallocated buffer)
+   * \param smoothness Smoothness factor > 1 (more resulting points when closer to 1)
+   * \param precision Minimal distance between two subsequent points
+   * \return Output iterator past the last written vertex
+   *
+   * Same polyline as getPolyline, computed without caching and heap allocations
+   */
+  template <typename OutputIt>
+  OutputIt writePolyline(OutputIt out, double smoothness = 1.0001, double precision = 1.0) const
+  {
+    return Flattening::subdivide(control_points_.col(0).data(), control_points_.col(1).data(), N_, out, smoothness,
+                                 precision);
+  }
+
+  /*!
+   * \brief Get a polyline representation of curve within given distance from curve
+   * \param tolerance Maximal distance between curve and polyline
+   * \return A vector of polyline vertices
+   *
+   * Number of vertices follows the curvature and is close to the minimum for given
+   * tolerance, see Flattening::withTolerance. If a polyline with at most half of the
+   * tolerance is cached, result is simplified from it instead (see Flattening::simplify).
+   */
+  PointVector getPolylineWithTolerance(double tolerance = 0.25) const;
+
+  /*!
+   * \brief Write a polyline representation of curve within given distance to an output iterator
+   * \param out Output iterator receiving polyline vertices (e.g. pointer to a preallocated buffer)
+   * \param tolerance Maximal distance between curve and polyline
+   * \return Output iterator past the last written vertex
+   *
+   * Polyline is always flattened from the curve, without caching and heap allocations
+   */
+  template <typename OutputIt> OutputIt writePolylineWithTolerance(OutputIt out, double tolerance = 0.25) const
+  {
+    if (tolerance <= 0)
+      throw "Tolerance must be positive.";
+    return Flattening::withTolerance(control_points_.col(0).data(), control_points_.col(1).data(), N_, out,
+                                     tolerance);
+  }
+
+  /*!
+   * \brief Pass a polyline representation of curve to a sink, vertex by vertex
+   * \param sink Callable receiving each vertex as sink(const Point&), e.g. a lambda
+   * \param smoothness Smoothness factor > 1 (more resulting points when closer to 1)
+   * \param precision Minimal distance between two subsequent points
+   *
+   * Vertices are emitted as subdivision proceeds, without materializing the polyline.
+   * If the same polyline is already cached, its vertices are emitted without copying.
+   * Use writePolyline for output iterators.
+   */
+  template <typename Sink> void streamPolyline(Sink&& sink, double smoothness = 1.0001, double precision = 1.0) const
+  {
+    if (auto polyline = findPolyline(smoothness, precision, 0))
+      for (auto&& vertex : polyline->points)
+        sink(vertex);
+    else
+      writePolyline(Flattening::SinkIterator<typename std::remove_reference<Sink>::type>{&sink}, smoothness, precision);
+  }
+
+  /*!
+   * \brief Pass a polyline representation of curve within given distance to a sink, vertex by vertex
+   * \param sink Callable receiving each vertex as sink(const Point&), e.g. a lambda
+   * \param tolerance Maximal distance between curve and polyline
+   *
+   * Vertices are emitted as subdivision proceeds, without materializing the polyline.
+   * If the same polyline is already cached, its vertices are emitted without copying.
+   * Use writePolylineWithTolerance for output iterators.
+   */
+  template <typename Sink> void streamPolylineWithTolerance(Sink&& sink, double tolerance = 0.25) const
+  {
+    if (auto polyline = findPolyline(0, 0, tolerance))
+      for (auto&& vertex : polyline->points)
+        sink(vertex);
+    else
+      writePolylineWithTolerance(Flattening::SinkIterator<typename std::remove_reference<Sink>::type>{&sink},
+                                 tolerance);
+  }
+
   /*!
    * \brief Set the new coordinates to a control point
    * \param index Index of chosen control point
@@ -160,6 +553,18 @@ public:
    */
   void lowerOrder();
 
+  /*!
+   * \brief Set the algorithm used for evaluating points on this curve
+   * \param method Evaluation algorithm
+   */
+  void setEvaluationMethod(EvaluationMethod method);
+
+  /*!
+   * \brief Get the algorithm used for evaluating points on this curve
+   * \return Evaluation algorithm
+   */
+  EvaluationMethod getEvaluationMethod() const;
+
   /*!
    * \brief Get the point on curve for a given t
    * \param t Curve parameter
@@ -167,6 +572,34 @@ public:
    */
   Point valueAt(double t) const;
 
+  /*!
+   * \brief Get the point on curve for a given t
+   * \param t Curve parameter
+   * \param method Evaluation algorithm to use for this call
+   * \return Point on a curve for a given t
+   */
+  Point valueAt(double t, EvaluationMethod method) const;
+
+  /*!
+   * \brief Get the points on curve for a vector of t
+   * \param t_vector Vector of curve parameters
+   * \return Vector of points on a curve, one for each t
+   *
+   * All points are evaluated in a single vectorized pass
+   */
+  PointVector valueAt(const std::vector<double>& t_vector) const;
+
+  /*!
+   * \brief Get the points on curve for an array of t
+   * \param t Array of curve parameters
+   * \param count Number of curve parameters
+   * \param x Array for count resulting x coordinates
+   * \param y Array for count resulting y coordinates
+   *
+   * All points are evaluated in a single vectorized pass, without allocating memory
+   */
+  void valueAt(const double* t, std::size_t count, double* x, double* y) const;
+
   /*!
    * \brief Get curvature of curve for a given t
    * \param t Curve parameter
@@ -182,6 +615,14 @@ public:
    */
   Vec2 tangentAt(double t, bool normalize = true) const;
 
+  /*!
+   * \brief Get the tangents of curve for a vector of t
+   * \param t_vector Vector of curve parameters
+   * \param normalize If the resulting tangents should be normalized
+   * \return Vector of tangents of a curve, one for each t
+   */
+  std::vector<Vec2> tangentAt(const std::vector<double>& t_vector, bool normalize = true) const;
+
   /*!
    * \brief Get the normal of curve for a given t
    * \param t Curve parameter
@@ -190,6 +631,14 @@ public:
    */
   Vec2 normalAt(double t, bool normalize = true) const;
 
+  /*!
+   * \brief Get the normals of curve for a vector of t
+   * \param t_vector Vector of curve parameters
+   * \param normalize If the resulting normals should be normalized
+   * \return Vector of normals of a curve, one for each t
+   */
+  std::vector<Vec2> normalAt(const std::vector<double>& t_vector, bool normalize = true) const;
+
   /*!
    * \brief Get the derivative of a curve
    * \return Derivative curve
@@ -198,12 +647,36 @@ public:
 
   /*!
    * \brief Get the extreme points of curve
-   * \param step Size of step in coarse search
+   * \return A vector of extreme points
+   *
+   * Same as getExtremes with default precision, result is cached with curve
+   */
+  std::vector<Point> getRoots() const;
+
+  /*!
+   * \brief Get the extreme points of curve
+   * \param step Ignored, there is no coarse search anymore
+   * \param epsilon Precision of resulting t
+   * \param max_iter Ignored, it limited Newton-Rhapson iterations
+   * \return A vector of extreme points
+   *
+   * \deprecated Kept so that calls written for the former coarse search, such as getRoots(0.1, 0.001),
+   * still mean the same; use getExtremes to control precision of the root solver
+   */
+  BEZIER_DEPRECATED("use getRoots() or getExtremes(epsilon, max_iter)")
+  std::vector<Point> getRoots(double step, double epsilon = 0.001, std::size_t max_iter = 15) const;
+
+  /*!
+   * \brief Get the extreme points of curve with given precision
    * \param epsilon Precision of resulting t
-   * \param max_iter Maximum number of iterations for Newton-Rhapson
+   * \param max_iter Budget of subdivision and refinement steps per axis
    * \return A vector of extreme points
+   *
+   * Extremes are found in closed form up to quartic curves, higher orders use
+   * Bernstein::roots on coefficients of derivative. Only the result with default
+   * arguments is cached, see getRoots.
    */
-  std::vector<Point> getRoots(double step = 0.1, double epsilon = 0.001, std::size_t max_iter = 15) const;
+  std::vector<Point> getExtremes(double epsilon = extremes_epsilon, std::size_t max_iter = extremes_max_iter) const;
 
   /*!
    * \brief Get the bounding box of curve
@@ -219,25 +692,130 @@ public:
    */
   std::pair<Curve, Curve> splitCurve(double z = 0.5) const;
 
+  /*!
+   * \brief Split the curve into two existing subcurves
+   * \param left Curve receiving subcurve t = [0, z]
+   * \param right Curve receiving subcurve t = [z, 1]
+   * \param z Parameter t at which to split the curve
+   *
+   * Both halves are computed in a single de Casteljau pass; memory of left and right
+   * is reused if they already have the same number of control points
+   */
+  void splitCurve(Curve& left, Curve& right, double z = 0.5) const;
+
+  /*!
+   * \brief Get the part of curve between two parameters
+   * \param t0 Parameter t where the subcurve starts
+   * \param t1 Parameter t where the subcurve ends (subcurve is reversed if t1 < t0)
+   * \return Subcurve t = [t0, t1]
+   */
+  Curve subCurve(double t0, double t1) const;
+
   /*!
    * \brief Get the points of intersection with another curve
    * \param curve Curve to intersect with
    * \param stop_at_first If first point of intersection is enough
    * \param epsilon Precision of resulting intersection
+   * \param method Algorithm used for finding intersections
    * \return A vector af points of intersection between curves
    */
-  std::vector<Point> getPointsOfIntersection(const Curve& curve, bool stop_at_first = false,
-                                             double epsilon = 0.001) const;
+  std::vector<Point> getPointsOfIntersection(const Curve& curve, bool stop_at_first = false, double epsilon = 0.001,
+                                             IntersectionMethod method = IntersectionMethod::Subdivision) const;
+
+  /*!
+   * \brief Get the intersections with another curve, together with parameters on both curves
+   * \param curve Curve to intersect with
+   * \param epsilon Precision of resulting intersection
+   * \param method Algorithm used for finding intersections
+   * \return A vector of intersections, where t1 belongs to this curve and t2 to the other one
+   *
+   * Parameters are tracked during subdivision, so no projection onto curves is needed.
+   * Bezier clipping (Sederberg-Nishita) clips each curve to the parameter range where it can
+   * lie within the fat line of the other one; subcurves are halved when clipping removes less
+   * than 20 % of the range, which happens around multiple intersections and tangencies.
+   *
+   * Intersecting the curve with itself gives its self-intersections, see getSelfIntersections.
+   *
+   * Overlapping curves yield only both ends of their common part with Bezier clipping, together
+   * with intersections outside of it. Subdivision yields points of common part spaced about epsilon
+   * apart instead.
+   */
+  std::vector<Intersection> getIntersections(const Curve& curve, double epsilon = 0.001,
+                                             IntersectionMethod method = IntersectionMethod::BezierClipping) const;
+
+  /*!
+   * \brief Get the points where curve intersects itself
+   * \param epsilon Precision of resulting intersection
+   * \return A vector of self-intersections, where t1 < t2 are the parameters of both passes through the point
+   *
+   * Cubic curves have at most one self-intersection, found in closed form. Higher orders are split
+   * at extremes into monotone pieces, and non-adjacent pieces are intersected with Bezier clipping.
+   */
+  std::vector<Intersection> getSelfIntersections(double epsilon = 0.001) const;
+
+  /*!
+   * \brief Get the intersections with straight line, ray or segment
+   * \param p1 First point defining the line
+   * \param p2 Second point defining the line, different from p1
+   * \param type Extent of line
+   * \param epsilon Precision of resulting t for curves of order higher than cubic
+   * \return A vector of intersections sorted by t1, which belongs to this curve, while t2 is the
+   * position on line as in p1 + t2 (p2 - p1)
+   *
+   * Signed distances of control points from line are Bernstein coefficients of distance of
+   * curve, so intersections are roots of single polynomial, found in closed form up to
+   * cubic curves. Only the returned vector is allocated for those.
+   *
+   * \warning line containing a part of the curve gives no intersections
+   */
+  std::vector<Intersection> getLineIntersections(const Point& p1, const Point& p2, LineType type = LineType::Segment,
+                                                 double epsilon = 1e-10) const;
 
   /*!
    * \brief Get the parameter t where curve is closes to given point
    * \param point Point to project on curve
-   * \param step Size of step in coarse search
+   * \param method Algorithm used for projecting
+   * \param epsilon Precision of resulting t
    * \return Parameter t
    *
-   * \warning self-intersection not yet implemented
+   * Exact candidates are end points and roots of (B(t) - P) . B'(t), found with Bernstein::roots.
+   * Newton method starts from the closest of 16 (N - 1) + 1 samples cached with curve and stays
+   * within its neighbouring samples, so it misses the global minimum only if the curve comes
+   * back closer to the point between two samples.
+   */
+  double projectPointOnCurve(const Point& point, ProjectionMethod method = ProjectionMethod::Exact,
+                             double epsilon = 1e-10) const;
+
+  /*!
+   * \brief Get the parameter t where curve is closes to given point
+   * \param point Point to project on curve
+   * \param step Ignored, there is no coarse search anymore
+   * \return Parameter t, found with exact method and default precision
+   *
+   * \deprecated Kept so that calls written for the former coarse search, such as
+   * projectPointOnCurve(point, 0.01), don't pass their step as precision
+   */
+  BEZIER_DEPRECATED("use projectPointOnCurve(point, method, epsilon)")
+  double projectPointOnCurve(const Point& point, double step) const;
+
+  /*!
+   * \brief Project many points on curve, in parallel
+   * \param x Array of count x coordinates of points
+   * \param y Array of count y coordinates of points
+   * \param count Number of points
+   * \param t Array receiving count parameters t of closest points on curve
+   * \param distance Array receiving count distances from curve, or nullptr if not needed
+   * \param method Algorithm used for projecting
+   * \param epsilon Precision of resulting t
+   * \param threads Number of threads (0 for number of hardware threads)
+   *
+   * Each t is the same as from projectPointOnCurve with the same method. Data depending only
+   * on curve, cached samples for Newton method or coefficients of (B(t) - P) . B'(t) for exact
+   * method, is prepared once for the whole batch, and no memory is allocated per point.
    */
-  double projectPointOnCurve(const Point& point, double step = 0.01) const;
+  void projectPointsOnCurve(const double* x, const double* y, std::size_t count, double* t, double* distance = nullptr,
+                            ProjectionMethod method = ProjectionMethod::Exact, double epsilon = 1e-10,
+                            unsigned threads = 0) const;
 };
 }
 
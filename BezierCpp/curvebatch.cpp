@@ -0,0 +1,222 @@
+#include "curvebatch.h"
+
+namespace Bezier
+{
+/// Capacity is kept a multiple of this, so that every column of coordinates is aligned for SIMD
+const std::size_t column_alignment = 8;
+
+inline std::size_t alignedCapacity(std::size_t size)
+{
+  return (size + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+CurveBatch::CurveBatch(uint n) : N_(n), xs_(0, n), ys_(0, n) {}
+
+CurveBatch::CurveBatch(const std::vector<Curve>& curves)
+{
+  if (curves.empty())
+    throw "Cannot determine the order of an empty batch.";
+
+  N_ = curves.front().getControlPoints().size();
+  xs_.resize(alignedCapacity(curves.size()), N_);
+  ys_.resize(alignedCapacity(curves.size()), N_);
+  for (auto&& curve : curves)
+    addCurve(curve);
+}
+
+std::size_t CurveBatch::size() const { return size_; }
+
+uint CurveBatch::order() const { return N_ - 1; }
+
+void CurveBatch::addCurve(const Curve& curve)
+{
+  PointVector points = curve.getControlPoints();
+  if (points.size() != N_)
+    throw "All curves in batch must have the same order.";
+
+  if (size_ == static_cast<std::size_t>(xs_.rows()))
+  {
+    std::size_t capacity = alignedCapacity(std::max<std::size_t>(2 * size_, 1));
+    xs_.conservativeResize(capacity, N_);
+    ys_.conservativeResize(capacity, N_);
+  }
+  for (uint k = 0; k < N_; k++)
+  {
+    xs_(size_, k) = points.at(k).x();
+    ys_(size_, k) = points.at(k).y();
+  }
+  size_++;
+}
+
+Curve CurveBatch::getCurve(std::size_t index) const
+{
+  Eigen::MatrixX2d points(N_, 2);
+  points.col(0) = xs_.row(index).transpose().matrix();
+  points.col(1) = ys_.row(index).transpose().matrix();
+  return Curve(points);
+}
+
+Eigen::MatrixX2d CurveBatch::valueAt(double t) const
+{
+  // Bernstein polynomials are the same for all curves
+  const uint degree = N_ - 1;
+  Eigen::VectorXd weights(N_);
+  for (uint k = 0; k < N_; k++)
+    weights(k) = Bernstein::binomial(degree, k) * pow(t, k) * pow(1 - t, degree - k);
+
+  Eigen::MatrixX2d points(size_, 2);
+  points.col(0).noalias() = xs_.topRows(size_).matrix() * weights;
+  points.col(1).noalias() = ys_.topRows(size_).matrix() * weights;
+  return points;
+}
+
+Eigen::ArrayXd CurveBatch::valueAt(const Eigen::ArrayXXd& coords, const Eigen::ArrayXd& t) const
+{
+  // Horner scheme in Bernstein basis, vectorized across curves
+  const uint degree = N_ - 1;
+  Eigen::ArrayXd u = 1 - t;
+  Eigen::ArrayXd t_power = Eigen::ArrayXd::Ones(size_);
+  Eigen::ArrayXd value = coords.col(0).head(size_) * u;
+  double binomial_coeff = 1;
+  for (uint k = 1; k < degree; k++)
+  {
+    t_power *= t;
+    binomial_coeff = binomial_coeff * (degree - k + 1) / k;
+    value = (value + binomial_coeff * t_power * coords.col(k).head(size_)) * u;
+  }
+  return value + t_power * t * coords.col(degree).head(size_);
+}
+
+std::vector<Eigen::ArrayXd> CurveBatch::extremesAt(const Eigen::ArrayXXd& coords) const
+{
+  // roots of derivative, where invalid roots are replaced by t = 0 (already included as end point)
+  std::vector<Eigen::ArrayXd> roots;
+  auto valid = [](const Eigen::ArrayXd& t)
+  {
+    return ((t > 0) && (t < 1)).select(t, 0);
+  };
+
+  Eigen::ArrayXd d0 = coords.col(1).head(size_) - coords.col(0).head(size_);
+  Eigen::ArrayXd d1 = coords.col(2).head(size_) - coords.col(1).head(size_);
+  if (N_ == 3)
+  {
+    // derivative is linear
+    roots.push_back(valid((d0 != d1).select(d0 / (d0 - d1), 0)));
+  }
+  else if (N_ == 4)
+  {
+    // derivative is quadratic
+    Eigen::ArrayXd d2 = coords.col(3).head(size_) - coords.col(2).head(size_);
+    Eigen::ArrayXd a = d0 - 2 * d1 + d2;
+    Eigen::ArrayXd b = 2 * (d1 - d0);
+    Eigen::ArrayXd delta = (b.square() - 4 * a * d0).max(0);
+    Eigen::ArrayXd linear = (b != 0).select(-d0 / b, 0);
+    roots.push_back(valid((a.abs() < 1e-12).select(linear, (-b + delta.sqrt()) / (2 * a))));
+    roots.push_back(valid((a.abs() < 1e-12).select(linear, (-b - delta.sqrt()) / (2 * a))));
+  }
+  return roots;
+}
+
+std::vector<BBox> CurveBatch::getBBox(bool use_roots) const
+{
+  Eigen::ArrayXd min_x, min_y, max_x, max_y;
+  if (!use_roots)
+  {
+    min_x = max_x = xs_.col(0).head(size_);
+    min_y = max_y = ys_.col(0).head(size_);
+    for (uint k = 1; k < N_; k++)
+    {
+      min_x = min_x.min(xs_.col(k).head(size_));
+      max_x = max_x.max(xs_.col(k).head(size_));
+      min_y = min_y.min(ys_.col(k).head(size_));
+      max_y = max_y.max(ys_.col(k).head(size_));
+    }
+  }
+  else if (N_ <= 4)
+  {
+    min_x = xs_.col(0).head(size_).min(xs_.col(N_ - 1).head(size_));
+    max_x = xs_.col(0).head(size_).max(xs_.col(N_ - 1).head(size_));
+    min_y = ys_.col(0).head(size_).min(ys_.col(N_ - 1).head(size_));
+    max_y = ys_.col(0).head(size_).max(ys_.col(N_ - 1).head(size_));
+    if (N_ > 2)
+    {
+      for (auto&& t : extremesAt(xs_))
+      {
+        Eigen::ArrayXd x = valueAt(xs_, t);
+        min_x = min_x.min(x);
+        max_x = max_x.max(x);
+      }
+      for (auto&& t : extremesAt(ys_))
+      {
+        Eigen::ArrayXd y = valueAt(ys_, t);
+        min_y = min_y.min(y);
+        max_y = max_y.max(y);
+      }
+    }
+  }
+  else
+  {
+    // no closed form for extremes, use individual curves
+    std::vector<BBox> bboxes;
+    bboxes.reserve(size_);
+    for (std::size_t k = 0; k < size_; k++)
+    {
+      Curve curve = getCurve(k);
+      curve.setCachingEnabled(false);
+      bboxes.push_back(curve.getBBox(true));
+    }
+    return bboxes;
+  }
+
+  std::vector<BBox> bboxes;
+  bboxes.reserve(size_);
+  for (std::size_t k = 0; k < size_; k++)
+    bboxes.push_back(BBox(Point(min_x(k), min_y(k)), Point(max_x(k), max_y(k))));
+  return bboxes;
+}
+
+std::pair<CurveBatch, CurveBatch> CurveBatch::splitCurve(double z) const
+{
+  CurveBatch left(N_), right(N_);
+  left.size_ = right.size_ = size_;
+  left.xs_.resize(xs_.rows(), N_);
+  left.ys_.resize(ys_.rows(), N_);
+  right.xs_.resize(xs_.rows(), N_);
+  right.ys_.resize(ys_.rows(), N_);
+
+  // de Casteljau, vectorized across curves:
+  // first point of each level belongs to left, last one to right subcurve
+  Eigen::ArrayXXd points_x = xs_, points_y = ys_;
+  for (uint k = 0; k < N_; k++)
+  {
+    left.xs_.col(k) = points_x.col(0);
+    left.ys_.col(k) = points_y.col(0);
+    right.xs_.col(N_ - 1 - k) = points_x.col(N_ - 1 - k);
+    right.ys_.col(N_ - 1 - k) = points_y.col(N_ - 1 - k);
+    for (uint i = 0; i < N_ - 1 - k; i++)
+    {
+      points_x.col(i) = (1 - z) * points_x.col(i) + z * points_x.col(i + 1);
+      points_y.col(i) = (1 - z) * points_y.col(i) + z * points_y.col(i + 1);
+    }
+  }
+  return std::make_pair(left, right);
+}
+
+void CurveBatch::getPolyline(PointVector& vertices, std::vector<std::size_t>& offsets, double smoothness,
+                             double precision) const
+{
+  vertices.clear();
+  offsets.clear();
+  offsets.reserve(size_ + 1);
+  Eigen::ArrayXXd points(N_, 2);
+  for (std::size_t k = 0; k < size_; k++)
+  {
+    offsets.push_back(vertices.size());
+    points.col(0) = xs_.row(k).transpose();
+    points.col(1) = ys_.row(k).transpose();
+    Flattening::subdivide(points.col(0).data(), points.col(1).data(), N_, std::back_inserter(vertices), smoothness,
+                          precision);
+  }
+  offsets.push_back(vertices.size());
+}
+}
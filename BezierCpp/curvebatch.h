@@ -0,0 +1,251 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CURVEBATCH_H
+#define CURVEBATCH_H
+
+#include "bezier.h"
+#include "parallel.h"
+
+#include <numeric>
+
+namespace Bezier
+{
+/*!
+ * \brief A container for many Bezier curves of the same order
+ *
+ * Control points are stored in structure-of-arrays layout: x and y coordinates
+ * are kept in separate arrays, where k-th control points of all curves are
+ * contiguous in memory and aligned for SIMD. Bulk operations process all
+ * curves at once, vectorized across curves.
+ */
+class CurveBatch
+{
+private:
+  /// Number of control points of each curve (order + 1)
+  uint N_;
+  /// Number of curves in batch
+  std::size_t size_ = 0;
+  /// capacity x N array of x coordinates, column k holds k-th control points of all curves
+  Eigen::ArrayXXd xs_;
+  /// capacity x N array of y coordinates, column k holds k-th control points of all curves
+  Eigen::ArrayXXd ys_;
+
+  /// Get t of extremes on one axis for each curve (0 where extreme does not exist), only up to cubic curves
+  std::vector<Eigen::ArrayXd> extremesAt(const Eigen::ArrayXXd& coords) const;
+
+  /// Get values of one axis for each curve at its own t
+  Eigen::ArrayXd valueAt(const Eigen::ArrayXXd& coords, const Eigen::ArrayXd& t) const;
+
+public:
+  /*!
+   * \brief Create an empty batch
+   * \param n Number of control points of each curve
+   */
+  explicit CurveBatch(uint n);
+
+  /*!
+   * \brief Create a batch from a vector of curves
+   * \param curves Non-empty vector of curves with the same number of control points
+   */
+  CurveBatch(const std::vector<Curve>& curves);
+
+  /*!
+   * \brief Get the number of curves in batch
+   * \return Number of curves
+   */
+  std::size_t size() const;
+
+  /*!
+   * \brief Get the order of curves in batch
+   * \return Order of curves (number of control points - 1)
+   */
+  uint order() const;
+
+  /*!
+   * \brief Add the curve to the end of batch
+   * \param curve Curve with the same number of control points as the batch
+   */
+  void addCurve(const Curve& curve);
+
+  /*!
+   * \brief Get the curve from batch
+   * \param index Index of curve
+   * \return Copy of curve
+   */
+  Curve getCurve(std::size_t index) const;
+
+  /*!
+   * \brief Get the points on all curves for a given t
+   * \param t Curve parameter
+   * \return size() x 2 matrix where each row is point on one curve
+   */
+  Eigen::MatrixX2d valueAt(double t) const;
+
+  /*!
+   * \brief Get the bounding boxes of all curves
+   * \param use_roots If algorithm should use extreme points
+   * \return Vector of bounding boxes, one for each curve
+   */
+  std::vector<BBox> getBBox(bool use_roots = true) const;
+
+  /*!
+   * \brief Split all curves into two subcurves
+   * \param z Parameter t at which to split the curves
+   * \return Pair of batches with subcurves for t = [0, z] and t = [z, 1]
+   */
+  std::pair<CurveBatch, CurveBatch> splitCurve(double z = 0.5) const;
+
+  /*!
+   * \brief Get polyline representations of all curves in a single buffer
+   * \param vertices Buffer receiving vertices of all polylines, one after another
+   * \param offsets Buffer receiving size() + 1 indices of first vertex of each polyline (last one is end of buffer)
+   * \param smoothness Smoothness factor > 1 (more resulting points when closer to 1)
+   * \param precision Minimal distance between two subsequent points
+   */
+  void getPolyline(PointVector& vertices, std::vector<std::size_t>& offsets, double smoothness = 1.0001,
+                   double precision = 1.0) const;
+};
+
+/// Access the curve through reference
+inline const Curve& curveReference(const Curve& curve) { return curve; }
+
+/// Access the curve through pointer
+inline const Curve& curveReference(const Curve* curve) { return *curve; }
+
+/*!
+ * \brief Get polyline representations of many curves in a single buffer, in parallel
+ * \param first Random access iterator to the first curve (or pointer to curve)
+ * \param last Random access iterator past the last curve (or pointer to curve)
+ * \param vertices Buffer receiving vertices of all polylines, one after another
+ * \param offsets Buffer receiving (last - first) + 1 indices of first vertex of each polyline (last one is end of buffer)
+ * \param smoothness Smoothness factor > 1 (more resulting points when closer to 1)
+ * \param precision Minimal distance between two subsequent points
+ * \param threads Number of threads (0 for number of hardware threads)
+ *
+ * Polylines are the same as from Curve::getPolyline, but are neither taken from nor stored
+ * to the curves' caches. In the first pass each thread only counts vertices of its curves,
+ * after which the buffer is allocated once and the second pass writes vertices in place.
+ */
+template <typename RandomIt>
+void getPolylines(RandomIt first, RandomIt last, PointVector& vertices, std::vector<std::size_t>& offsets,
+                  double smoothness = 1.0001, double precision = 1.0, unsigned threads = 0)
+{
+  const std::size_t count = static_cast<std::size_t>(last - first);
+  const std::size_t grain = 64;
+  offsets.resize(count + 1);
+  offsets.front() = 0;
+  Parallel::forEach(count, threads, grain, [&](std::size_t begin, std::size_t end)
+                    {
+                      for (std::size_t k = begin; k < end; k++)
+                        offsets[k + 1] =
+                            curveReference(first[k]).writePolyline(Flattening::VertexCounter(), smoothness, precision).count;
+                    });
+
+  for (std::size_t k = 0; k < count; k++)
+    offsets[k + 1] += offsets[k];
+  vertices.resize(offsets.back());
+
+  Parallel::forEach(count, threads, grain, [&](std::size_t begin, std::size_t end)
+                    {
+                      for (std::size_t k = begin; k < end; k++)
+                        curveReference(first[k]).writePolyline(&vertices[offsets[k]], smoothness, precision);
+                    });
+}
+
+/*!
+ * \brief Intersection of two curves from a collection
+ */
+struct CurvesIntersection
+{
+  std::size_t curve1;        /*! Index of first curve */
+  std::size_t curve2;        /*! Index of second curve, always greater than curve1 */
+  Intersection intersection; /*! Parameters t1 on first and t2 on second curve, and point of intersection */
+};
+
+/*!
+ * \brief Get the intersections of all pairs of curves, in parallel
+ * \param first Random access iterator to the first curve (or pointer to curve)
+ * \param last Random access iterator past the last curve (or pointer to curve)
+ * \param epsilon Precision of resulting intersections
+ * \param method Algorithm used for finding intersections of a pair of curves
+ * \param threads Number of threads (0 for number of hardware threads)
+ * \return A vector of intersections, ordered by indices of curves relative to first
+ *
+ * Broad phase sweeps over bounding boxes sorted along the axis where they are spread more,
+ * so only pairs with overlapping boxes are intersected with Curve::getIntersections.
+ * Pairs are processed on multiple threads, each curve with the curves following it in
+ * sweep order; results don't depend on the number of threads. Self-intersections of
+ * single curves are not included.
+ */
+template <typename RandomIt>
+std::vector<CurvesIntersection> intersectAll(RandomIt first, RandomIt last, double epsilon = 0.001,
+                                             IntersectionMethod method = IntersectionMethod::BezierClipping,
+                                             unsigned threads = 0)
+{
+  const std::size_t count = static_cast<std::size_t>(last - first);
+  std::vector<BBox> bboxes(count);
+  Parallel::forEach(count, threads, 64, [&](std::size_t begin, std::size_t end)
+                    {
+                      for (std::size_t k = begin; k < end; k++)
+                        bboxes[k] = curveReference(first[k]).getBBox(true);
+                    });
+
+  BBox centers;
+  for (auto&& bbox : bboxes)
+    centers.extend(bbox.center());
+  const long axis = count == 0 || centers.sizes().x() >= centers.sizes().y() ? 0 : 1;
+  std::vector<std::size_t> order(count);
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::sort(order.begin(), order.end(), [&bboxes, axis](std::size_t lhs, std::size_t rhs)
+            {
+              return bboxes[lhs].min()(axis) < bboxes[rhs].min()(axis);
+            });
+
+  // intersections found by k-th curve in sweep order, with every following curve starting before its end
+  std::vector<std::vector<CurvesIntersection>> found(count);
+  Parallel::forEach(count, threads, 16, [&](std::size_t begin, std::size_t end)
+                    {
+                      for (std::size_t k = begin; k < end; k++)
+                      {
+                        const BBox& bbox = bboxes[order[k]];
+                        const double sweep_end = bbox.max()(axis);
+                        for (std::size_t i = k + 1; i < count && bboxes[order[i]].min()(axis) <= sweep_end; i++)
+                        {
+                          if (!bbox.intersects(bboxes[order[i]]))
+                            continue;
+                          const std::size_t curve1 = std::min(order[k], order[i]);
+                          const std::size_t curve2 = std::max(order[k], order[i]);
+                          for (auto&& intersection : curveReference(first[curve1])
+                                                         .getIntersections(curveReference(first[curve2]), epsilon, method))
+                            found[k].push_back(CurvesIntersection{curve1, curve2, intersection});
+                        }
+                      }
+                    });
+
+  std::vector<CurvesIntersection> intersections;
+  for (auto&& part : found)
+    intersections.insert(intersections.end(), part.begin(), part.end());
+  std::stable_sort(intersections.begin(), intersections.end(),
+                   [](const CurvesIntersection& lhs, const CurvesIntersection& rhs)
+                   {
+                     return lhs.curve1 < rhs.curve1 || (lhs.curve1 == rhs.curve1 && lhs.curve2 < rhs.curve2);
+                   });
+  return intersections;
+}
+}
+
+#endif // CURVEBATCH_H
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIXEDCURVE_H
+#define FIXEDCURVE_H
+
+#include "bezier.h"
+
+namespace Bezier
+{
+/*!
+ * \brief A Bezier curve class with number of control points known at compile time
+ *
+ * Lightweight counterpart of Bezier::Curve for curves of fixed order (e.g. cubic).
+ * Control points are stored inline in a fixed-size matrix, so creating, copying
+ * and evaluating the curve performs no heap allocation, and all loops have
+ * compile-time bounds. No data is cached.
+ *
+ * \warning As with any fixed-size vectorizable Eigen type, use Eigen::aligned_allocator
+ * when storing FixedCurve objects in STL containers
+ */
+template <uint N> class FixedCurve
+{
+  static_assert(N > 0, "Curve needs at least one control point");
+
+public:
+  /*!
+   * \brief N x 2 matrix where each row corresponds to control Point
+   */
+  typedef Eigen::Matrix<double, N, 2> ControlPoints;
+
+private:
+  /// N x 2 matrix where each row corresponds to control Point
+  ControlPoints control_points_;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /*!
+   * \brief Create the Bezier curve
+   * \param points Nx2 matrix where each row is one of N control points that define the curve
+   */
+  FixedCurve(const ControlPoints& points) : control_points_(points) {}
+
+  /*!
+   * \brief Create the fixed-order copy of dynamic Bezier curve
+   * \param curve Curve with exactly N control points
+   */
+  explicit FixedCurve(const Curve& curve)
+  {
+    PointVector points = curve.getControlPoints();
+    if (points.size() != N)
+      throw "Number of control points does not match the order of fixed curve.";
+    for (uint k = 0; k < N; k++)
+      control_points_.row(k) = points.at(k);
+  }
+
+  /*!
+   * \brief Get the equivalent dynamic Bezier curve
+   * \return Bezier::Curve with same control points
+   */
+  Curve toCurve() const { return Curve(Eigen::MatrixX2d(control_points_)); }
+
+  /*!
+   * \brief Get the control points
+   * \return Nx2 matrix of control points
+   */
+  const ControlPoints& getControlPoints() const { return control_points_; }
+
+  /*!
+   * \brief Get the point on curve for a given t
+   * \param t Curve parameter
+   * \return Point on a curve for a given t
+   */
+  Point valueAt(double t) const
+  {
+    ControlPoints points = control_points_;
+    for (uint k = N - 1; k > 0; k--)
+      for (uint i = 0; i < k; i++)
+        points.row(i) = (1 - t) * points.row(i) + t * points.row(i + 1);
+    return points.row(0);
+  }
+
+  /*!
+   * \brief Get the tangent of curve for a given t
+   * \param t Curve parameter
+   * \param normalize If the resulting tangent should be normalized
+   * \return Tangent of a curve for a given t
+   */
+  Vec2 tangentAt(double t, bool normalize = true) const
+  {
+    Vec2 p(getDerivative().valueAt(t));
+    if (normalize)
+      p.normalize();
+    return p;
+  }
+
+  /*!
+   * \brief Get the normal of curve for a given t
+   * \param t Curve parameter
+   * \param normalize If the resulting normal should be normalized
+   * \return Normal of a curve for given t
+   */
+  Vec2 normalAt(double t, bool normalize = true) const
+  {
+    Vec2 tangent = tangentAt(t, normalize);
+    return Vec2(-tangent.y(), tangent.x());
+  }
+
+  /*!
+   * \brief Get the derivative of a curve
+   * \return Derivative curve with N - 1 control points
+   */
+  FixedCurve<N - 1> getDerivative() const
+  {
+    static_assert(N > 1, "Cannot get derivative of a single point");
+    typename FixedCurve<N - 1>::ControlPoints new_points;
+    for (uint k = 0; k < N - 1; k++)
+      new_points.row(k) = (N - 1) * (control_points_.row(k + 1) - control_points_.row(k));
+    return FixedCurve<N - 1>(new_points);
+  }
+
+  /*!
+   * \brief Get the bounding box of curve
+   * \param use_roots If algorithm should use extreme points
+   * \return Bounding box (if use_roots is false, returns the bounding box of control points)
+   *
+   * Extreme points are found in closed form up to quartic curves,
+   * higher orders fall back to Bezier::Curve::getBBox
+   */
+  BBox getBBox(bool use_roots = true) const
+  {
+    if (!use_roots)
+      return BBox(control_points_.colwise().minCoeff().transpose(), control_points_.colwise().maxCoeff().transpose());
+    if (N > 5)
+      return toCurve().getBBox(true);
+
+    BBox bbox(Point(control_points_.row(0)));
+    bbox.extend(Point(control_points_.row(N - 1)));
+    if (N > 2)
+    {
+      // Bernstein coefficients of derivative, scaling is irrelevant for roots
+      Eigen::Matrix<double, N - 1, 2> derivative =
+          control_points_.template bottomRows<N - 1>() - control_points_.template topRows<N - 1>();
+      for (uint k = 0; k < 2; k++)
+      {
+        double roots[3];
+        uint count = Bernstein::rootsClosedForm(derivative.col(k).data(), N - 1, roots);
+        for (uint i = 0; i < count; i++)
+          bbox.extend(valueAt(roots[i]));
+      }
+    }
+    return bbox;
+  }
+
+  /*!
+   * \brief Split the curve into two subcurves
+   * \param z Parameter t at which to split the curve
+   * \return Pair of two subcurves
+   */
+  std::pair<FixedCurve, FixedCurve> splitCurve(double z = 0.5) const
+  {
+    ControlPoints left, right, points = control_points_;
+    // de Casteljau: first point of each level belongs to left, last one to right subcurve
+    for (uint k = 0; k < N; k++)
+    {
+      left.row(k) = points.row(0);
+      right.row(N - 1 - k) = points.row(N - 1 - k);
+      for (uint i = 0; i < N - 1 - k; i++)
+        points.row(i) = (1 - z) * points.row(i) + z * points.row(i + 1);
+    }
+    return std::make_pair(FixedCurve(left), FixedCurve(right));
+  }
+};
+}
+
+#endif // FIXEDCURVE_H
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLATTENING_H
+#define FLATTENING_H
+
+#include "bernstein.h"
+#include <iterator>
+
+namespace Bezier
+{
+/*!
+ * \brief Kernels approximating a curve with a polyline
+ *
+ * Curve is given by x and y coordinates of its n control points in two contiguous
+ * arrays, resulting vertices are written as Eigen::Vector2d to an output iterator.
+ */
+namespace Flattening
+{
+/*!
+ * \brief Maximal depth of subdivision (at most 2^max_depth segments)
+ */
+const uint max_depth = 24;
+
+/*!
+ * \brief Output iterator counting written vertices instead of storing them
+ *
+ * Used for sizing the output before writing vertices in place
+ */
+struct VertexCounter
+{
+  std::size_t count = 0; /*! Number of vertices written so far */
+
+  VertexCounter& operator*() { return *this; }
+  VertexCounter& operator++() { return *this; }
+  VertexCounter& operator++(int) { return *this; }
+  VertexCounter& operator=(const Eigen::Vector2d&)
+  {
+    count++;
+    return *this;
+  }
+};
+
+/*!
+ * \brief Output iterator passing written vertices to a callable sink
+ *
+ * Sink is called as sink(vertex) and is referenced, not copied, so it can keep state
+ */
+template <typename Sink> struct SinkIterator
+{
+  Sink* sink; /*! Callable receiving vertices */
+
+  SinkIterator& operator*() { return *this; }
+  SinkIterator& operator++() { return *this; }
+  SinkIterator& operator++(int) { return *this; }
+  SinkIterator& operator=(const Eigen::Vector2d& vertex)
+  {
+    (*sink)(vertex);
+    return *this;
+  }
+};
+
+/*!
+ * \brief Traverse subcurves obtained by halving the curve, depth first from the beginning
+ * \param x Array of n x coordinates of control points
+ * \param y Array of n y coordinates of control points
+ * \param n Number of control points
+ * \param out Output iterator receiving vertices, starting with the first control point
+ * \param accept Functor (x, y, depth, out) -> bool which writes the subcurve as segments ending
+ * at its last control point and returns true, or returns false to halve the subcurve;
+ * 2 n values after y can be used as scratch memory
+ * \return Output iterator past the last written vertex
+ *
+ * Subcurves are halved with in-place de Casteljau algorithm on a fixed-size stack of
+ * control points, so no memory is allocated for curves up to Bernstein::max_stack_coeffs
+ * control points. Subcurves at max_depth are always accepted.
+ */
+template <typename OutputIt, typename Accept>
+OutputIt traverse(const double* x, const double* y, uint n, OutputIt out, Accept accept)
+{
+  if (n == 0)
+    return out;
+  *out++ = Eigen::Vector2d(x[0], y[0]);
+
+  // k-th subcurve on stack has x at 2 * k * n and y at (2 * k + 1) * n
+  double stack_buffer[(max_depth + 2) * 2 * Bernstein::max_stack_coeffs];
+  std::vector<double> heap_buffer;
+  double* buffer = stack_buffer;
+  if (n > Bernstein::max_stack_coeffs)
+  {
+    heap_buffer.resize((max_depth + 2) * 2 * n);
+    buffer = heap_buffer.data();
+  }
+  uint depth[max_depth + 2];
+
+  std::copy(x, x + n, buffer);
+  std::copy(y, y + n, buffer + n);
+  depth[0] = 0;
+  uint size = 1;
+  while (size > 0)
+  {
+    double* cx = buffer + 2 * (size - 1) * n;
+    double* cy = cx + n;
+    const uint current_depth = depth[--size];
+    if (accept(cx, cy, current_depth, out))
+      continue;
+
+    // in-place de Casteljau at 0.5 leaves right half in place, left half is collected above it
+    double* lx = cy + n;
+    double* ly = lx + n;
+    for (uint k = 0; k < n; k++)
+    {
+      lx[k] = cx[0];
+      ly[k] = cy[0];
+      for (uint i = 0; i < n - 1 - k; i++)
+      {
+        cx[i] = (cx[i] + cx[i + 1]) / 2;
+        cy[i] = (cy[i] + cy[i + 1]) / 2;
+      }
+    }
+    depth[size++] = current_depth + 1;
+    depth[size++] = current_depth + 1;
+  }
+  return out;
+}
+
+/*!
+ * \brief Approximate the curve with polyline by adaptive subdivision
+ * \param x Array of n x coordinates of control points
+ * \param y Array of n y coordinates of control points
+ * \param n Number of control points
+ * \param out Output iterator receiving vertices, starting with the first control point
+ * \param smoothness Smoothness factor > 1 (more resulting points when closer to 1)
+ * \param precision Minimal distance between two subsequent points
+ * \return Output iterator past the last written vertex
+ *
+ * Subcurve is accepted as a segment when the length of its control polygon is within
+ * smoothness factor of its chord, or the chord is shorter than precision.
+ */
+template <typename OutputIt>
+OutputIt subdivide(const double* x, const double* y, uint n, OutputIt out, double smoothness, double precision)
+{
+  auto accept = [=](double* cx, double* cy, uint depth, OutputIt& vertices)
+  {
+    double hull = 0;
+    for (uint k = 1; k < n; k++)
+      hull += std::sqrt(std::pow(cx[k] - cx[k - 1], 2) + std::pow(cy[k] - cy[k - 1], 2));
+    const double chord = std::sqrt(std::pow(cx[n - 1] - cx[0], 2) + std::pow(cy[n - 1] - cy[0], 2));
+    if (hull < smoothness * chord || chord / smoothness < precision || depth == max_depth)
+    {
+      *vertices++ = Eigen::Vector2d(cx[n - 1], cy[n - 1]);
+      return true;
+    }
+    return false;
+  };
+  return traverse(x, y, n, out, accept);
+}
+
+/*!
+ * \brief Approximate the curve with polyline within given distance
+ * \param x Array of n x coordinates of control points
+ * \param y Array of n y coordinates of control points
+ * \param n Number of control points
+ * \param out Output iterator receiving vertices, starting with the first control point
+ * \param tolerance Maximal distance between curve and polyline, must be positive
+ * \return Output iterator past the last written vertex
+ *
+ * Uses bound on second differences of control points (Wang's formula): splitting the
+ * curve of degree d uniformly into m segments keeps the polyline within
+ * d (d - 1) / (8 m^2) max|P[k+2] - 2 P[k+1] + P[k]| of the curve. Subcurve is halved only
+ * when its halves need fewer segments together than the whole one, so the number of
+ * segments follows local curvature.
+ */
+template <typename OutputIt> OutputIt withTolerance(const double* x, const double* y, uint n, OutputIt out, double tolerance)
+{
+  const double factor = n < 3 ? 0 : (n - 1) * (n - 2) / (8 * tolerance);
+  auto segments = [factor](double squared_second_difference)
+  {
+    return std::max(1., std::ceil(std::sqrt(factor * std::sqrt(squared_second_difference))));
+  };
+
+  auto accept = [=](double* cx, double* cy, uint depth, OutputIt& vertices)
+  {
+    // second differences are (scaled) Bernstein coefficients of the second derivative,
+    // halving them with de Casteljau gives second differences of both halves times 4
+    double* dx = cy + n;
+    double* dy = dx + n;
+    double whole = 0, left = 0, right = 0;
+    for (uint k = 2; k < n; k++)
+    {
+      dx[k - 2] = cx[k] - 2 * cx[k - 1] + cx[k - 2];
+      dy[k - 2] = cy[k] - 2 * cy[k - 1] + cy[k - 2];
+      whole = std::max(whole, dx[k - 2] * dx[k - 2] + dy[k - 2] * dy[k - 2]);
+    }
+    const double count = segments(whole);
+    if (count > 1 && depth < max_depth)
+    {
+      for (uint k = 0; k + 2 < n; k++)
+      {
+        left = std::max(left, dx[0] * dx[0] + dy[0] * dy[0]);
+        for (uint i = 0; i + k + 3 < n; i++)
+        {
+          dx[i] = (dx[i] + dx[i + 1]) / 2;
+          dy[i] = (dy[i] + dy[i + 1]) / 2;
+        }
+      }
+      for (uint k = 0; k + 2 < n; k++)
+        right = std::max(right, dx[k] * dx[k] + dy[k] * dy[k]);
+      // on a tie, halving can still pay off deeper, unless second derivative is constant
+      const double halves = segments(left / 16) + segments(right / 16);
+      if (halves < count || (halves == count && n > 3 && count > 4))
+        return false;
+    }
+
+    for (double k = 1; k < count; k++)
+      *vertices++ = Eigen::Vector2d(Bernstein::horner(cx, n, k / count), Bernstein::horner(cy, n, k / count));
+    *vertices++ = Eigen::Vector2d(cx[n - 1], cy[n - 1]);
+    return true;
+  };
+  return traverse(x, y, n, out, accept);
+}
+
+/*!
+ * \brief Simplify the polyline with Douglas-Peucker algorithm
+ * \param first Random access iterator to the first vertex
+ * \param last Random access iterator past the last vertex
+ * \param out Output iterator receiving kept vertices, including first and last one
+ * \param tolerance Maximal distance of removed vertices from simplified polyline
+ * \return Output iterator past the last written vertex
+ *
+ * Every point of the original polyline stays within tolerance of the simplified one,
+ * so a polyline within distance d of a curve is simplified to one within d + tolerance.
+ */
+template <typename RandomIt, typename OutputIt>
+OutputIt simplify(RandomIt first, RandomIt last, OutputIt out, double tolerance)
+{
+  const std::size_t size = static_cast<std::size_t>(last - first);
+  if (size < 3)
+    return std::copy(first, last, out);
+
+  std::vector<bool> keep(size, false);
+  keep.front() = keep.back() = true;
+  std::vector<std::pair<std::size_t, std::size_t>> ranges(1, std::make_pair(std::size_t(0), size - 1));
+  while (!ranges.empty())
+  {
+    const std::size_t begin = ranges.back().first, end = ranges.back().second;
+    ranges.pop_back();
+
+    const Eigen::Vector2d start = first[begin], segment = Eigen::Vector2d(first[end]) - start;
+    const double length = segment.squaredNorm();
+    double max_distance = tolerance * tolerance;
+    std::size_t farthest = begin;
+    for (std::size_t k = begin + 1; k < end; k++)
+    {
+      const Eigen::Vector2d vertex = Eigen::Vector2d(first[k]) - start;
+      const double t = length > 0 ? std::max(0., std::min(1., vertex.dot(segment) / length)) : 0;
+      const double distance = (vertex - t * segment).squaredNorm();
+      if (distance > max_distance)
+      {
+        max_distance = distance;
+        farthest = k;
+      }
+    }
+    if (farthest != begin)
+    {
+      keep[farthest] = true;
+      ranges.push_back(std::make_pair(begin, farthest));
+      ranges.push_back(std::make_pair(farthest, end));
+    }
+  }
+
+  for (std::size_t k = 0; k < size; k++)
+    if (keep[k])
+      *out++ = first[k];
+  return out;
+}
+}
+}
+
+#endif // FLATTENING_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Bezier
+{
+/*!
+ * \brief Helpers for running bulk operations on multiple threads
+ */
+namespace Parallel
+{
+/*!
+ * \brief Get the number of threads to use
+ * \param threads Requested number of threads (0 for number of hardware threads)
+ * \param count Number of items to process
+ * \param grain Minimal number of items worth a separate thread
+ * \return Number of threads, at least 1
+ */
+inline unsigned threadCount(unsigned threads, std::size_t count, std::size_t grain)
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t useful = (count + grain - 1) / grain;
+  return static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, useful)));
+}
+
+/*!
+ * \brief Process items [0, count) in chunks on multiple threads
+ * \param count Number of items
+ * \param threads Number of threads (0 for number of hardware threads), calling thread is one of them
+ * \param grain Number of items in a chunk
+ * \param fn Functor (begin, end) processing items [begin, end), must not throw
+ *
+ * Threads take chunks from a shared counter, so uneven work per item is balanced.
+ * Small inputs are processed on the calling thread only.
+ */
+template <typename Fn> void forEach(std::size_t count, unsigned threads, std::size_t grain, Fn fn)
+{
+  threads = threadCount(threads, count, grain);
+  if (threads == 1)
+  {
+    if (count > 0)
+      fn(std::size_t(0), count);
+    return;
+  }
+
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]()
+  {
+    for (std::size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain))
+      fn(begin, std::min(begin + grain, count));
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned k = 1; k < threads; k++)
+    workers.emplace_back(worker);
+  worker();
+  for (auto&& thread : workers)
+    thread.join();
+}
+}
+}
+
+#endif // PARALLEL_H
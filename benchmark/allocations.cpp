@@ -0,0 +1,104 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Counts heap allocations per call of hot curve operations. Both operator new and
+ * Eigen end in malloc, which is interposed here and forwarded to glibc.
+ *
+ * Exits with 1 if evaluating a point with Horner or de Casteljau method allocates.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+
+#include "bezier.h"
+
+#ifndef __GLIBC__
+#error "Counting allocations relies on interposing glibc malloc"
+#endif
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void __libc_free(void* pointer);
+}
+
+static std::atomic<std::size_t> allocations(0);
+
+extern "C"
+{
+void* malloc(std::size_t size)
+{
+  allocations++;
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+  allocations++;
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, std::size_t size)
+{
+  allocations++;
+  return __libc_realloc(pointer, size);
+}
+
+void free(void* pointer) { __libc_free(pointer); }
+}
+
+/// Average number of allocations per call, after a warm-up call which may fill caches
+static double allocationsPerCall(const std::function<void()>& call, std::size_t repeat = 1000)
+{
+  call();
+  const std::size_t before = allocations;
+  for (std::size_t k = 0; k < repeat; k++)
+    call();
+  return static_cast<double>(allocations - before) / repeat;
+}
+
+int main()
+{
+  Eigen::MatrixX2d points(4, 2);
+  points << 84, 162, 246, 30, 330, 230, 448, 118;
+  Bezier::Curve curve(points);
+
+  volatile double sink = 0;
+  auto value = [&](Bezier::EvaluationMethod method)
+  {
+    return [&curve, &sink, method]() { sink = sink + curve.valueAt(0.3, method).x(); };
+  };
+
+  const double horner = allocationsPerCall(value(Bezier::EvaluationMethod::Horner));
+  const double de_casteljau = allocationsPerCall(value(Bezier::EvaluationMethod::DeCasteljau));
+  const double power_basis = allocationsPerCall(value(Bezier::EvaluationMethod::PowerBasis));
+  const double split_half = allocationsPerCall([&]() { sink = sink + curve.splitCurve(0.5).first.valueAt(1).x(); });
+  const double split = allocationsPerCall([&]() { sink = sink + curve.splitCurve(0.3).first.valueAt(1).x(); });
+
+  std::printf("allocations per call, cubic curve\n");
+  std::printf("  valueAt (Horner)       %g\n", horner);
+  std::printf("  valueAt (DeCasteljau)  %g\n", de_casteljau);
+  std::printf("  valueAt (PowerBasis)   %g\n", power_basis);
+  std::printf("  splitCurve(0.5)        %g\n", split_half);
+  std::printf("  splitCurve(0.3)        %g\n", split);
+
+  return horner == 0 && de_casteljau == 0 ? 0 : 1;
+}
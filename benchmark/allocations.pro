@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Allocation count per call of hot curve operations
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = allocations
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+QMAKE_CXXFLAGS += -march=native
+
+INCLUDEPATH += /usr/include/eigen3 \
+    ../BezierCpp
+
+SOURCES += \
+        allocations.cpp \
+        ../BezierCpp/bezier.cpp
+
+HEADERS += \
+        ../BezierCpp/bezier.h \
+        ../BezierCpp/bernstein.h \
+        ../BezierCpp/flattening.h \
+        ../BezierCpp/parallel.h
@@ -32,12 +32,18 @@ SOURCES += \
         main.cpp \
         mainwindow.cpp \
         ../BezierCpp/bezier.cpp \
+        ../BezierCpp/curvebatch.cpp \
     qgraphicsviewzoom.cpp \
     customscene.cpp
 
 HEADERS += \
         mainwindow.h \
         ../BezierCpp/bezier.h \
+        ../BezierCpp/bernstein.h \
+        ../BezierCpp/curvebatch.h \
+        ../BezierCpp/fixedcurve.h \
+        ../BezierCpp/flattening.h \
+        ../BezierCpp/parallel.h \
     qgraphicsviewzoom.h \
     customscene.h
 
@@ -50,13 +50,8 @@ void CustomScene::drawForeground(QPainter* painter, const QRectF& rect)
 
     painter->setPen(Qt::red);
     painter->setBrush(QBrush(Qt::red, Qt::SolidPattern));
-    for (int k = 0; k < curves.size() - 1; k++)
-      for (int i = k + 1; i < curves.size(); i++)
-      {
-        auto inter = curves[k]->getPointsOfIntersection(*curves[i]);
-        for (auto& dot : inter)
-          painter->drawEllipse(QPointF(dot.x(), dot.y()), 3, 3);
-      }
+    for (auto&& inter : Bezier::intersectAll(curves.begin(), curves.end()))
+      painter->drawEllipse(QPointF(inter.intersection.point.x(), inter.intersection.point.y()), 3, 3);
   }
 }
 
@@ -136,7 +131,7 @@ void CustomScene::mouseMoveEvent(QGraphicsSceneMouseEvent* mouseEvent)
     dot->setRect(QRectF(QPointF(p.x() - 3, p.y() - 3), QSizeF(6, 6)));
     for (int k = 0; k < curves.size(); k++)
     {
-      auto t1 = curves[k]->projectPointOnCurve(Bezier::Point(p.x(), p.y()));
+      auto t1 = curves[k]->projectPointOnCurve(Bezier::Point(p.x(), p.y()), Bezier::ProjectionMethod::Newton);
       auto p1 = curves[k]->valueAt(t1);
       auto tan1 = curves[k]->tangentAt(t1);
       line[k]->setLine(QLineF(QPointF(p.x(), p.y()), QPointF(p1.x(), p1.y())));
@@ -7,6 +7,7 @@
 #include <QMessageBox>
 
 #include "bezier.h"
+#include "curvebatch.h"
 #include "qgraphicsviewzoom.h"
 
 namespace Ui
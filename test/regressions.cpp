@@ -0,0 +1,65 @@
+/*
+ * Copyright 2019 Mirko Kokot
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Regression checks for fixed bugs. Build without NDEBUG, so that Eigen's
+ * assertions are active. Exits with 1 if any check fails.
+ */
+
+#include <cstdio>
+
+#include "curvebatch.h"
+
+static int failures = 0;
+
+static void check(bool condition, const char* name)
+{
+  std::printf("%s  %s\n", condition ? "ok  " : "FAIL", name);
+  if (!condition)
+    failures++;
+}
+
+/// Bulk operations on a batch without curves give empty results
+static void emptyBatch()
+{
+  Bezier::CurveBatch batch(4);
+  check(batch.getBBox(true).empty() && batch.getBBox(false).empty(), "empty batch bounding boxes");
+  check(batch.valueAt(0.5).rows() == 0, "empty batch valueAt");
+  auto halves = batch.splitCurve();
+  check(halves.first.size() == 0 && halves.second.size() == 0, "empty batch splitCurve");
+}
+
+/// Cusp doesn't intersect itself, also when curve is elevated past closed-form cubic case
+static void elevatedCusp()
+{
+  Eigen::MatrixX2d points(4, 2);
+  points << 0, 0, 10, 10, 0, 10, 10, 0;
+  Bezier::Curve curve(points);
+  check(curve.getSelfIntersections().empty(), "cubic cusp has no self-intersection");
+  curve.elevateOrder();
+  check(curve.getSelfIntersections().empty(), "cusp elevated to 5 control points has no self-intersection");
+  curve.elevateOrder();
+  check(curve.getSelfIntersections().empty(), "cusp elevated to 6 control points has no self-intersection");
+  curve.elevateOrder();
+  check(curve.getSelfIntersections().empty(), "cusp elevated to 7 control points has no self-intersection");
+}
+
+int main()
+{
+  emptyBatch();
+  elevatedCusp();
+  return failures ? 1 : 0;
+}
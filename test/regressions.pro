@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Regression checks for fixed bugs
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = regressions
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+QMAKE_CXXFLAGS += -march=native
+
+INCLUDEPATH += /usr/include/eigen3 \
+    ../BezierCpp
+
+SOURCES += \
+        regressions.cpp \
+        ../BezierCpp/bezier.cpp \
+        ../BezierCpp/curvebatch.cpp
+
+HEADERS += \
+        ../BezierCpp/bezier.h \
+        ../BezierCpp/bernstein.h \
+        ../BezierCpp/curvebatch.h \
+        ../BezierCpp/flattening.h \
+        ../BezierCpp/parallel.h